@@ -58,6 +58,7 @@ P_BAD_BLOCK_TABLE_INFO_MAP bbtInfoMapPtr;
 
 unsigned char sliceAllocationTargetDie;
 unsigned int mbPerbadBlockSpace;
+unsigned int blockWriteSeq;	// bumped by every allocated slice, host writes are blockWriteSeq - copyCnt
 
 
 void InitAddressMap()
@@ -82,6 +83,7 @@ void InitAddressMap()
 	}
 
 	sliceAllocationTargetDie = FindDieForFreeSliceAllocation();
+	blockWriteSeq = 0;
 
 	InitSliceMap();
 	InitBlockDieMap();
@@ -213,6 +215,12 @@ void InitDieMap()
 		virtualDieMapPtr->die[dieNo].headFreeBlock = BLOCK_NONE;
 		virtualDieMapPtr->die[dieNo].tailFreeBlock = BLOCK_NONE;
 		virtualDieMapPtr->die[dieNo].freeBlockCnt = 0;
+		virtualDieMapPtr->die[dieNo].headEraseWaitBlock = BLOCK_NONE;
+		virtualDieMapPtr->die[dieNo].tailEraseWaitBlock = BLOCK_NONE;
+		virtualDieMapPtr->die[dieNo].eraseWaitBlockCnt = 0;
+		virtualDieMapPtr->die[dieNo].maxEraseCnt = 0;
+		virtualDieMapPtr->die[dieNo].wearScanBlock = 0;
+		virtualDieMapPtr->die[dieNo].wearLevelingBlock = BLOCK_NONE;
 	}
 }
 
@@ -232,6 +240,8 @@ void InitBlockMap()
 			virtualBlockMapPtr->block[dieNo][virtualBlockNo].invalidSliceCnt = 0;
 			virtualBlockMapPtr->block[dieNo][virtualBlockNo].currentPage = 0;
 			virtualBlockMapPtr->block[dieNo][virtualBlockNo].eraseCnt = 0;
+			virtualBlockMapPtr->block[dieNo][virtualBlockNo].gcVictim = 0;
+			virtualBlockMapPtr->block[dieNo][virtualBlockNo].lastWriteSeq = 0;
 
 			if(virtualBlockMapPtr->block[dieNo][virtualBlockNo].bad)
 			{
@@ -650,6 +660,7 @@ unsigned int AddrTransWrite(unsigned int logicalSliceAddr)
 		InvalidateOldVsa(logicalSliceAddr);
 
 		virtualSliceAddr = FindFreeVirtualSlice();
+		EarnGcCredit();
 
 		logicalSliceMapPtr->logicalSlice[logicalSliceAddr].virtualSliceAddr = virtualSliceAddr;
 		virtualSliceMapPtr->virtualSlice[virtualSliceAddr].logicalSliceAddr = logicalSliceAddr;
@@ -697,6 +708,7 @@ unsigned int FindFreeVirtualSlice()
 
 	virtualSliceAddr = Vorg2VsaTranslation(dieNo, currentBlock, virtualBlockMapPtr->block[dieNo][currentBlock].currentPage);
 	virtualBlockMapPtr->block[dieNo][currentBlock].currentPage++;
+	virtualBlockMapPtr->block[dieNo][currentBlock].lastWriteSeq = ++blockWriteSeq;
 	sliceAllocationTargetDie = FindDieForFreeSliceAllocation();
 	dieNo = sliceAllocationTargetDie;
 	return virtualSliceAddr;
@@ -732,10 +744,35 @@ unsigned int FindFreeVirtualSliceForGc(unsigned int copyTargetDieNo, unsigned in
 
 	virtualSliceAddr = Vorg2VsaTranslation(dieNo, currentBlock, virtualBlockMapPtr->block[dieNo][currentBlock].currentPage);
 	virtualBlockMapPtr->block[dieNo][currentBlock].currentPage++;
+	virtualBlockMapPtr->block[dieNo][currentBlock].lastWriteSeq = ++blockWriteSeq;
 	return virtualSliceAddr;
 }
 
 
+unsigned int FindFreeVirtualSliceForWearLeveling(unsigned int dieNo)
+{
+	unsigned int wearLevelingBlock, virtualSliceAddr;
+
+	wearLevelingBlock = virtualDieMapPtr->die[dieNo].wearLevelingBlock;
+
+	if((wearLevelingBlock == BLOCK_NONE) || (virtualBlockMapPtr->block[dieNo][wearLevelingBlock].currentPage == USER_PAGES_PER_BLOCK))
+	{
+		wearLevelingBlock = GetFromFbList(dieNo, GET_FREE_BLOCK_WEAR_LEVELING);
+
+		if(wearLevelingBlock != BLOCK_FAIL)
+			virtualDieMapPtr->die[dieNo].wearLevelingBlock = wearLevelingBlock;
+		else
+			assert(!"[WARNING] There is no available block [WARNING]");
+	}
+	else if(virtualBlockMapPtr->block[dieNo][wearLevelingBlock].currentPage > USER_PAGES_PER_BLOCK)
+		assert(!"[WARNING] Current page management fail [WARNING]");
+
+	virtualSliceAddr = Vorg2VsaTranslation(dieNo, wearLevelingBlock, virtualBlockMapPtr->block[dieNo][wearLevelingBlock].currentPage);
+	virtualBlockMapPtr->block[dieNo][wearLevelingBlock].currentPage++;
+	virtualBlockMapPtr->block[dieNo][wearLevelingBlock].lastWriteSeq = ++blockWriteSeq;
+	return virtualSliceAddr;
+}
+
 unsigned int FindDieForFreeSliceAllocation()
 {
 	static unsigned char targetCh = 0;
@@ -769,6 +806,14 @@ void InvalidateOldVsa(unsigned int logicalSliceAddr)
 		dieNo = Vsa2VdieTranslation(virtualSliceAddr);
 		blockNo = Vsa2VblockTranslation(virtualSliceAddr);
 
+		// a block under incremental gc is off the victim list
+		if(virtualBlockMapPtr->block[dieNo][blockNo].gcVictim)
+		{
+			virtualBlockMapPtr->block[dieNo][blockNo].invalidSliceCnt++;
+			logicalSliceMapPtr->logicalSlice[logicalSliceAddr].virtualSliceAddr = VSA_NONE;
+			return;
+		}
+
 		// unlink
 		SelectiveGetFromGcVictimList(dieNo, blockNo);
 		virtualBlockMapPtr->block[dieNo][blockNo].invalidSliceCnt++;
@@ -799,7 +844,10 @@ void EraseBlock(unsigned int dieNo, unsigned int blockNo)
 
 	// block map indicated blockNo initialization
 	virtualBlockMapPtr->block[dieNo][blockNo].free = 1;
+	virtualBlockMapPtr->block[dieNo][blockNo].gcVictim = 0;
 	virtualBlockMapPtr->block[dieNo][blockNo].eraseCnt++;
+	if(virtualBlockMapPtr->block[dieNo][blockNo].eraseCnt > virtualDieMapPtr->die[dieNo].maxEraseCnt)
+		virtualDieMapPtr->die[dieNo].maxEraseCnt = virtualBlockMapPtr->block[dieNo][blockNo].eraseCnt;
 	virtualBlockMapPtr->block[dieNo][blockNo].invalidSliceCnt = 0;
 	virtualBlockMapPtr->block[dieNo][blockNo].currentPage = 0;
 
@@ -812,6 +860,51 @@ void EraseBlock(unsigned int dieNo, unsigned int blockNo)
 	}
 }
 
+// a collected block holds no valid slice, it stays off both the victim and the free list until its erase is issued
+void PutToEraseWaitList(unsigned int dieNo, unsigned int blockNo)
+{
+	virtualBlockMapPtr->block[dieNo][blockNo].nextBlock = BLOCK_NONE;
+
+	if(virtualDieMapPtr->die[dieNo].tailEraseWaitBlock != BLOCK_NONE)
+	{
+		virtualBlockMapPtr->block[dieNo][blockNo].prevBlock = virtualDieMapPtr->die[dieNo].tailEraseWaitBlock;
+		virtualBlockMapPtr->block[dieNo][virtualDieMapPtr->die[dieNo].tailEraseWaitBlock].nextBlock = blockNo;
+		virtualDieMapPtr->die[dieNo].tailEraseWaitBlock = blockNo;
+	}
+	else
+	{
+		virtualBlockMapPtr->block[dieNo][blockNo].prevBlock = BLOCK_NONE;
+		virtualDieMapPtr->die[dieNo].headEraseWaitBlock = blockNo;
+		virtualDieMapPtr->die[dieNo].tailEraseWaitBlock = blockNo;
+	}
+
+	virtualDieMapPtr->die[dieNo].eraseWaitBlockCnt++;
+}
+
+unsigned int GetFromEraseWaitList(unsigned int dieNo)
+{
+	unsigned int evictedBlockNo;
+
+	evictedBlockNo = virtualDieMapPtr->die[dieNo].headEraseWaitBlock;
+	if(evictedBlockNo == BLOCK_NONE)
+		return BLOCK_NONE;
+
+	if(virtualBlockMapPtr->block[dieNo][evictedBlockNo].nextBlock != BLOCK_NONE)
+	{
+		virtualDieMapPtr->die[dieNo].headEraseWaitBlock = virtualBlockMapPtr->block[dieNo][evictedBlockNo].nextBlock;
+		virtualBlockMapPtr->block[dieNo][virtualBlockMapPtr->block[dieNo][evictedBlockNo].nextBlock].prevBlock = BLOCK_NONE;
+	}
+	else
+	{
+		virtualDieMapPtr->die[dieNo].headEraseWaitBlock = BLOCK_NONE;
+		virtualDieMapPtr->die[dieNo].tailEraseWaitBlock = BLOCK_NONE;
+	}
+
+	virtualDieMapPtr->die[dieNo].eraseWaitBlockCnt--;
+
+	return evictedBlockNo;
+}
+
 void PutToFbList(unsigned int dieNo, unsigned int blockNo) //fb means free block
 {
 	if(virtualDieMapPtr->die[dieNo].tailFreeBlock != BLOCK_NONE)
@@ -834,7 +927,11 @@ void PutToFbList(unsigned int dieNo, unsigned int blockNo) //fb means free block
 
 unsigned int GetFromFbList(unsigned int dieNo, unsigned int getFreeBlockOption) //fb means free block
 {
-	unsigned int evictedBlockNo;
+	unsigned int evictedBlockNo, blockNo, prevBlock, nextBlock, windowCnt;
+
+	// erase ahead of demand fell behind, the block is taken right after its erase is issued
+	if((virtualDieMapPtr->die[dieNo].freeBlockCnt <= RESERVED_FREE_BLOCK_COUNT) && virtualDieMapPtr->die[dieNo].eraseWaitBlockCnt)
+		EraseBlock(dieNo, GetFromEraseWaitList(dieNo));
 
 	evictedBlockNo = virtualDieMapPtr->die[dieNo].headFreeBlock;
 
@@ -843,7 +940,7 @@ unsigned int GetFromFbList(unsigned int dieNo, unsigned int getFreeBlockOption)
 		if(virtualDieMapPtr->die[dieNo].freeBlockCnt <= RESERVED_FREE_BLOCK_COUNT)
 			return BLOCK_FAIL;
 	}
-	else if(getFreeBlockOption == GET_FREE_BLOCK_GC)
+	else if((getFreeBlockOption == GET_FREE_BLOCK_GC) || (getFreeBlockOption == GET_FREE_BLOCK_WEAR_LEVELING))
 	{
 		if(evictedBlockNo == BLOCK_NONE)
 			return BLOCK_FAIL;
@@ -851,16 +948,39 @@ unsigned int GetFromFbList(unsigned int dieNo, unsigned int getFreeBlockOption)
 	else
 		assert(!"[WARNING] Wrong getFreeBlockOption [WARNING]");
 
-	if(virtualBlockMapPtr->block[dieNo][evictedBlockNo].nextBlock != BLOCK_NONE)
+	blockNo = virtualBlockMapPtr->block[dieNo][evictedBlockNo].nextBlock;
+	if(getFreeBlockOption == GET_FREE_BLOCK_WEAR_LEVELING)
 	{
-		virtualDieMapPtr->die[dieNo].headFreeBlock = virtualBlockMapPtr->block[dieNo][evictedBlockNo].nextBlock;
-		virtualBlockMapPtr->block[dieNo][virtualBlockMapPtr->block[dieNo][evictedBlockNo].nextBlock].prevBlock = BLOCK_NONE;
+		// cold data rests in the most worn free block, the worn block stops taking erases
+		while(blockNo != BLOCK_NONE)
+		{
+			if(virtualBlockMapPtr->block[dieNo][blockNo].eraseCnt > virtualBlockMapPtr->block[dieNo][evictedBlockNo].eraseCnt)
+				evictedBlockNo = blockNo;
+
+			blockNo = virtualBlockMapPtr->block[dieNo][blockNo].nextBlock;
+		}
 	}
 	else
-	{
-		virtualDieMapPtr->die[dieNo].headFreeBlock = BLOCK_NONE;
-		virtualDieMapPtr->die[dieNo].tailFreeBlock = BLOCK_NONE;
-	}
+		for(windowCnt = 1; (windowCnt < WEAR_LEVELING_FREE_BLOCK_WINDOW) && (blockNo != BLOCK_NONE); windowCnt++)
+		{
+			if(virtualBlockMapPtr->block[dieNo][blockNo].eraseCnt < virtualBlockMapPtr->block[dieNo][evictedBlockNo].eraseCnt)
+				evictedBlockNo = blockNo;
+
+			blockNo = virtualBlockMapPtr->block[dieNo][blockNo].nextBlock;
+		}
+
+	prevBlock = virtualBlockMapPtr->block[dieNo][evictedBlockNo].prevBlock;
+	nextBlock = virtualBlockMapPtr->block[dieNo][evictedBlockNo].nextBlock;
+
+	if(prevBlock != BLOCK_NONE)
+		virtualBlockMapPtr->block[dieNo][prevBlock].nextBlock = nextBlock;
+	else
+		virtualDieMapPtr->die[dieNo].headFreeBlock = nextBlock;
+
+	if(nextBlock != BLOCK_NONE)
+		virtualBlockMapPtr->block[dieNo][nextBlock].prevBlock = prevBlock;
+	else
+		virtualDieMapPtr->die[dieNo].tailFreeBlock = prevBlock;
 
 	virtualBlockMapPtr->block[dieNo][evictedBlockNo].free = 0;
 	virtualDieMapPtr->die[dieNo].freeBlockCnt--;
@@ -68,6 +68,10 @@
 
 #define GET_FREE_BLOCK_NORMAL	0x0
 #define GET_FREE_BLOCK_GC		0x1
+#define GET_FREE_BLOCK_WEAR_LEVELING	0x2
+
+// dynamic wear leveling, the least worn of this many blocks at the head of the free list is allocated, their erases are long done
+#define WEAR_LEVELING_FREE_BLOCK_WINDOW		8	//user configurable factor
 
 #define BLOCK_STATE_NORMAL						0
 #define BLOCK_STATE_BAD							1
@@ -131,11 +135,13 @@ typedef struct _VIRTUAL_BLOCK_ENTRY {
 	unsigned int bad : 1;
 	unsigned int free : 1;
 	unsigned int invalidSliceCnt : 16;
-	unsigned int reserved0 :10;
+	unsigned int gcVictim : 1;
+	unsigned int reserved0 :9;
 	unsigned int currentPage : 16;
 	unsigned int eraseCnt : 16;
 	unsigned int prevBlock : 16;
 	unsigned int nextBlock :16;
+	unsigned int lastWriteSeq;	// blockWriteSeq of the last slice allocated in the block, the age of the block for victim selection
 } VIRTUAL_BLOCK_ENTRY, *P_VIRTUAL_BLOCK_ENTRY;
 
 typedef struct _VIRTUAL_BLOCK_MAP {
@@ -150,7 +156,12 @@ typedef struct _VIRTUAL_DIE_ENTRY {
 	unsigned int freeBlockCnt : 16;
 	unsigned int prevDie : 8;
 	unsigned int nextDie : 8;
-	unsigned int reserved0 : 16;
+	unsigned int eraseWaitBlockCnt : 16;
+	unsigned int headEraseWaitBlock : 16;	// collected blocks waiting for their erase, issued ahead of demand
+	unsigned int tailEraseWaitBlock : 16;
+	unsigned int maxEraseCnt : 16;
+	unsigned int wearScanBlock : 16;		// next block static wear leveling looks at
+	unsigned int wearLevelingBlock : 16;	// destination of cold data moved by static wear leveling, kept apart from host writes
 } VIRTUAL_DIE_ENTRY, *P_VIRTUAL_DIE_ENTRY;
 
 typedef struct _VIRTUAL_DIE_MAP {
@@ -192,12 +203,15 @@ unsigned int AddrTransRead(unsigned int logicalSliceAddr);
 unsigned int AddrTransWrite(unsigned int logicalSliceAddr);
 unsigned int FindFreeVirtualSlice();
 unsigned int FindFreeVirtualSliceForGc(unsigned int copyTargetDieNo, unsigned int victimBlockNo);
+unsigned int FindFreeVirtualSliceForWearLeveling(unsigned int dieNo);
 unsigned int FindDieForFreeSliceAllocation();
 
 void InvalidateOldVsa(unsigned int logicalSliceAddr);
 void EraseBlock(unsigned int dieNo, unsigned int blockNo);
 
 void PutToFbList(unsigned int dieNo, unsigned int blockNo);
+void PutToEraseWaitList(unsigned int dieNo, unsigned int blockNo);
+unsigned int GetFromEraseWaitList(unsigned int dieNo);
 unsigned int GetFromFbList(unsigned int dieNo, unsigned int getFreeBlockOption);
 
 void UpdatePhyBlockMapForGrownBadBlock(unsigned int dieNo, unsigned int phyBlockNo);
@@ -213,5 +227,6 @@ extern P_BAD_BLOCK_TABLE_INFO_MAP bbtInfoMapPtr;
 
 extern unsigned char sliceAllocationTargetDie;
 extern unsigned int mbPerbadBlockSpace;
+extern unsigned int blockWriteSeq;
 
 #endif /* ADDRESS_TRANSLATION_H_ */
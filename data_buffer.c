@@ -47,20 +47,37 @@
 #include "xil_printf.h"
 #include <assert.h>
 #include "memory_map.h"
+#include "xpseudo_asm.h"
+
+#ifdef DATA_BUF_LOOKUP_PROFILE
+#include "xtime_l.h"
+
+#define DATA_BUF_LOOKUP_PROFILE_COUNT	1000000
+#endif
 
 
 P_DATA_BUF_MAP dataBufMapPtr;
-DATA_BUF_LRU_LIST dataBufLruList;
+DATA_BUF_LRU_LIST dataBufLruList[DATA_BUF_LIST_COUNT];
+DATA_BUF_GHOST_TABLE dataBufGhostTable;
+unsigned int dataBufProbationTarget;
+unsigned int dataBufHitCnt;
+unsigned int dataBufMissCnt;
+unsigned int dataBufPartialWriteCnt;
+unsigned int dataBufMergeReadCnt;
 P_DATA_BUF_HASH_TABLE dataBufHashTablePtr;
 P_TEMPORARY_DATA_BUF_MAP tempDataBufMapPtr;
+P_BYPASS_DATA_BUF_MAP bypassDataBufMapPtr;
+unsigned int dirtyDataBufCnt;
+READ_STREAM_TABLE readStreamTable;
 
 void InitDataBuf()
 {
-	int bufEntry;
+	int bufEntry, streamNo, listNo, bucketNo, slotNo;
 
 	dataBufMapPtr = (P_DATA_BUF_MAP) DATA_BUFFER_MAP_ADDR;
 	dataBufHashTablePtr = (P_DATA_BUF_HASH_TABLE)DATA_BUFFFER_HASH_TABLE_ADDR;
 	tempDataBufMapPtr = (P_TEMPORARY_DATA_BUF_MAP)TEMPORARY_DATA_BUFFER_MAP_ADDR;
+	bypassDataBufMapPtr = (P_BYPASS_DATA_BUF_MAP)BYPASS_DATA_BUFFER_MAP_ADDR;
 
 	for(bufEntry = 0; bufEntry < AVAILABLE_DATA_BUFFER_ENTRY_COUNT; bufEntry++)
 	{
@@ -68,110 +85,323 @@ void InitDataBuf()
 		dataBufMapPtr->dataBuf[bufEntry].prevEntry = bufEntry-1;
 		dataBufMapPtr->dataBuf[bufEntry].nextEntry = bufEntry+1;
 		dataBufMapPtr->dataBuf[bufEntry].dirty = DATA_BUF_CLEAN;
+		dataBufMapPtr->dataBuf[bufEntry].prefetched = DATA_BUF_NOT_PREFETCHED;
+		dataBufMapPtr->dataBuf[bufEntry].list = DATA_BUF_LIST_PROBATION;
+		dataBufMapPtr->dataBuf[bufEntry].validMask = DATA_BUF_VALID_ALL;
+		dataBufMapPtr->dataBuf[bufEntry].mergeMask = 0;
 		dataBufMapPtr->dataBuf[bufEntry].blockingReqTail =  REQ_SLOT_TAG_NONE;
 
-		dataBufHashTablePtr->dataBufHash[bufEntry].headEntry = DATA_BUF_NONE;
-		dataBufHashTablePtr->dataBufHash[bufEntry].tailEntry = DATA_BUF_NONE;
-		dataBufMapPtr->dataBuf[bufEntry].hashPrevEntry = DATA_BUF_NONE;
-		dataBufMapPtr->dataBuf[bufEntry].hashNextEntry = DATA_BUF_NONE;
 	}
 
+	for(bucketNo = 0; bucketNo < DATA_BUF_HASH_BUCKET_COUNT; bucketNo++)
+	{
+		for(slotNo = 0; slotNo < DATA_BUF_HASH_SLOTS_PER_BUCKET; slotNo++)
+		{
+			dataBufHashTablePtr->dataBufHash[bucketNo].slot[slotNo].logicalSliceAddr = LSA_NONE;
+			dataBufHashTablePtr->dataBufHash[bucketNo].slot[slotNo].bufEntry = DATA_BUF_NONE;
+		}
+		dataBufHashTablePtr->dataBufHash[bucketNo].overflowCnt = 0;
+	}
+
+	for(listNo = 0; listNo < DATA_BUF_LIST_COUNT; listNo++)
+		for(bufEntry = 0; bufEntry < DATA_BUF_GHOST_ENTRY_COUNT; bufEntry++)
+			dataBufGhostTable.logicalSliceAddr[listNo][bufEntry] = LSA_NONE;
+
+	//every entry starts on probation, the protected list fills up with re-referenced slices
 	dataBufMapPtr->dataBuf[0].prevEntry = DATA_BUF_NONE;
 	dataBufMapPtr->dataBuf[AVAILABLE_DATA_BUFFER_ENTRY_COUNT - 1].nextEntry = DATA_BUF_NONE;
-	dataBufLruList.headEntry = 0 ;
-	dataBufLruList.tailEntry = AVAILABLE_DATA_BUFFER_ENTRY_COUNT - 1;
+	dataBufLruList[DATA_BUF_LIST_PROBATION].headEntry = 0 ;
+	dataBufLruList[DATA_BUF_LIST_PROBATION].tailEntry = AVAILABLE_DATA_BUFFER_ENTRY_COUNT - 1;
+	dataBufLruList[DATA_BUF_LIST_PROBATION].entryCnt = AVAILABLE_DATA_BUFFER_ENTRY_COUNT;
+	dataBufLruList[DATA_BUF_LIST_PROTECTED].headEntry = DATA_BUF_NONE;
+	dataBufLruList[DATA_BUF_LIST_PROTECTED].tailEntry = DATA_BUF_NONE;
+	dataBufLruList[DATA_BUF_LIST_PROTECTED].entryCnt = 0;
+
+	dataBufProbationTarget = DATA_BUF_PROBATION_TARGET_INIT;
+	dataBufHitCnt = 0;
+	dataBufMissCnt = 0;
+	dataBufPartialWriteCnt = 0;
+	dataBufMergeReadCnt = 0;
+	dirtyDataBufCnt = 0;
+
+	for(streamNo = 0; streamNo < READ_STREAM_COUNT; streamNo++)
+	{
+		readStreamTable.stream[streamNo].nextLsa = LSA_NONE;
+		readStreamTable.stream[streamNo].prefetchLsa = LSA_NONE;
+		readStreamTable.stream[streamNo].seqCnt = 0;
+		readStreamTable.stream[streamNo].depth = READ_AHEAD_MIN_DEPTH;
+	}
+	readStreamTable.replaceStreamNo = 0;
+	readStreamTable.prefetchCnt = 0;
+	readStreamTable.prefetchHitCnt = 0;
+	readStreamTable.prefetchUnusedCnt = 0;
 
 	for(bufEntry = 0; bufEntry < AVAILABLE_TEMPORARY_DATA_BUFFER_ENTRY_COUNT; bufEntry++)
 		tempDataBufMapPtr->tempDataBuf[bufEntry].blockingReqTail =  REQ_SLOT_TAG_NONE;
+	for(bufEntry = 0; bufEntry < USER_DIES; bufEntry++)
+		tempDataBufMapPtr->nextEntryOfDie[bufEntry] = 0;
+
+	for(bufEntry = 0; bufEntry < AVAILABLE_BYPASS_DATA_BUFFER_ENTRY_COUNT; bufEntry++)
+		bypassDataBufMapPtr->bypassDataBuf[bufEntry].blockingReqTail =  REQ_SLOT_TAG_NONE;
+	bypassDataBufMapPtr->nextEntry = 0;
 }
 
 unsigned int CheckDataBufHit(unsigned int reqSlotTag)
 {
 	unsigned int bufEntry, logicalSliceAddr;
 
+#ifdef DATA_BUF_LOOKUP_PROFILE
+	static XTime lookupTime = 0;
+	static unsigned int lookupCnt = 0;
+	XTime tStart, tEnd;
+#endif
+
 	logicalSliceAddr = reqPoolPtr->reqPool[reqSlotTag].logicalSliceAddr;
-	bufEntry = dataBufHashTablePtr->dataBufHash[FindDataBufHashTableEntry(logicalSliceAddr)].headEntry;
+#ifdef DATA_BUF_LOOKUP_PROFILE
+	XTime_GetTime(&tStart);
+#endif
+	bufEntry = FindDataBuf(logicalSliceAddr);
+#ifdef DATA_BUF_LOOKUP_PROFILE
+	XTime_GetTime(&tEnd);
+	lookupTime += tEnd - tStart;
+	lookupCnt++;
+
+	if(lookupCnt == DATA_BUF_LOOKUP_PROFILE_COUNT)
+	{
+		xil_printf("FindDataBuf: %d ticks per %d lookups\r\n", (unsigned int)lookupTime, lookupCnt);
+		lookupTime = 0;
+		lookupCnt = 0;
+	}
+#endif
 
-	while(bufEntry != DATA_BUF_NONE)
+	if(bufEntry == DATA_BUF_FAIL)
 	{
-		if(dataBufMapPtr->dataBuf[bufEntry].logicalSliceAddr == logicalSliceAddr)
-		{
-			if((dataBufMapPtr->dataBuf[bufEntry].nextEntry != DATA_BUF_NONE) && (dataBufMapPtr->dataBuf[bufEntry].prevEntry != DATA_BUF_NONE))
-			{
-				dataBufMapPtr->dataBuf[dataBufMapPtr->dataBuf[bufEntry].prevEntry].nextEntry = dataBufMapPtr->dataBuf[bufEntry].nextEntry;
-				dataBufMapPtr->dataBuf[dataBufMapPtr->dataBuf[bufEntry].nextEntry].prevEntry = dataBufMapPtr->dataBuf[bufEntry].prevEntry;
-			}
-			else if((dataBufMapPtr->dataBuf[bufEntry].nextEntry == DATA_BUF_NONE) && (dataBufMapPtr->dataBuf[bufEntry].prevEntry != DATA_BUF_NONE))
-			{
-				dataBufMapPtr->dataBuf[dataBufMapPtr->dataBuf[bufEntry].prevEntry].nextEntry = DATA_BUF_NONE;
-				dataBufLruList.tailEntry = dataBufMapPtr->dataBuf[bufEntry].prevEntry;
-			}
-			else if((dataBufMapPtr->dataBuf[bufEntry].nextEntry != DATA_BUF_NONE) && (dataBufMapPtr->dataBuf[bufEntry].prevEntry== DATA_BUF_NONE))
-			{
-				dataBufMapPtr->dataBuf[dataBufMapPtr->dataBuf[bufEntry].nextEntry].prevEntry  = DATA_BUF_NONE;
-				dataBufLruList.headEntry = dataBufMapPtr->dataBuf[bufEntry].nextEntry;
-			}
-			else
-			{
-				dataBufLruList.tailEntry = DATA_BUF_NONE;
-				dataBufLruList.headEntry = DATA_BUF_NONE;
-			}
+		dataBufMissCnt++;
+		return DATA_BUF_FAIL;
+	}
 
-			if(dataBufLruList.headEntry != DATA_BUF_NONE)
-			{
-				dataBufMapPtr->dataBuf[bufEntry].prevEntry = DATA_BUF_NONE;
-				dataBufMapPtr->dataBuf[bufEntry].nextEntry = dataBufLruList.headEntry;
-				dataBufMapPtr->dataBuf[dataBufLruList.headEntry].prevEntry = bufEntry;
-				dataBufLruList.headEntry = bufEntry;
-			}
-			else
-			{
-				dataBufMapPtr->dataBuf[bufEntry].prevEntry = DATA_BUF_NONE;
-				dataBufMapPtr->dataBuf[bufEntry].nextEntry = DATA_BUF_NONE;
-				dataBufLruList.headEntry = bufEntry;
-				dataBufLruList.tailEntry = bufEntry;
-			}
+	//the first host reference of a prefetched slice counts as its first reference
+	SelectiveGetFromDataBufList(bufEntry);
+	if(dataBufMapPtr->dataBuf[bufEntry].prefetched == DATA_BUF_PREFETCHED)
+		PutToDataBufList(bufEntry, DATA_BUF_LIST_PROBATION);
+	else
+		PutToDataBufList(bufEntry, DATA_BUF_LIST_PROTECTED);
 
-			return bufEntry;
-		}
-		else
-			bufEntry = dataBufMapPtr->dataBuf[bufEntry].hashNextEntry;
+	dataBufHitCnt++;
+	return bufEntry;
+}
+
+void PutToDataBufList(unsigned int bufEntry, unsigned int listNo)
+{
+	if(dataBufLruList[listNo].headEntry != DATA_BUF_NONE)
+	{
+		dataBufMapPtr->dataBuf[bufEntry].prevEntry = DATA_BUF_NONE;
+		dataBufMapPtr->dataBuf[bufEntry].nextEntry = dataBufLruList[listNo].headEntry;
+		dataBufMapPtr->dataBuf[dataBufLruList[listNo].headEntry].prevEntry = bufEntry;
+		dataBufLruList[listNo].headEntry = bufEntry;
+	}
+	else
+	{
+		dataBufMapPtr->dataBuf[bufEntry].prevEntry = DATA_BUF_NONE;
+		dataBufMapPtr->dataBuf[bufEntry].nextEntry = DATA_BUF_NONE;
+		dataBufLruList[listNo].headEntry = bufEntry;
+		dataBufLruList[listNo].tailEntry = bufEntry;
 	}
 
-	return DATA_BUF_FAIL;
+	dataBufMapPtr->dataBuf[bufEntry].list = listNo;
+	dataBufLruList[listNo].entryCnt++;
 }
 
-unsigned int AllocateDataBuf()
+void SelectiveGetFromDataBufList(unsigned int bufEntry)
 {
-	unsigned int evictedEntry = dataBufLruList.tailEntry;
+	unsigned int listNo, prevBufEntry, nextBufEntry;
 
+	listNo = dataBufMapPtr->dataBuf[bufEntry].list;
+	prevBufEntry = dataBufMapPtr->dataBuf[bufEntry].prevEntry;
+	nextBufEntry = dataBufMapPtr->dataBuf[bufEntry].nextEntry;
+
+	if((nextBufEntry != DATA_BUF_NONE) && (prevBufEntry != DATA_BUF_NONE))
+	{
+		dataBufMapPtr->dataBuf[prevBufEntry].nextEntry = nextBufEntry;
+		dataBufMapPtr->dataBuf[nextBufEntry].prevEntry = prevBufEntry;
+	}
+	else if((nextBufEntry == DATA_BUF_NONE) && (prevBufEntry != DATA_BUF_NONE))
+	{
+		dataBufMapPtr->dataBuf[prevBufEntry].nextEntry = DATA_BUF_NONE;
+		dataBufLruList[listNo].tailEntry = prevBufEntry;
+	}
+	else if((nextBufEntry != DATA_BUF_NONE) && (prevBufEntry == DATA_BUF_NONE))
+	{
+		dataBufMapPtr->dataBuf[nextBufEntry].prevEntry = DATA_BUF_NONE;
+		dataBufLruList[listNo].headEntry = nextBufEntry;
+	}
+	else
+	{
+		dataBufLruList[listNo].headEntry = DATA_BUF_NONE;
+		dataBufLruList[listNo].tailEntry = DATA_BUF_NONE;
+	}
+
+	dataBufLruList[listNo].entryCnt--;
+}
+
+// the entry the next allocation evicts
+unsigned int SelectVictimDataBuf()
+{
+	if((dataBufLruList[DATA_BUF_LIST_PROBATION].entryCnt > dataBufProbationTarget) || (dataBufLruList[DATA_BUF_LIST_PROTECTED].entryCnt == 0))
+		return dataBufLruList[DATA_BUF_LIST_PROBATION].tailEntry;
+	else
+		return dataBufLruList[DATA_BUF_LIST_PROTECTED].tailEntry;
+}
+
+// pass LSA_NONE to place the entry on probation regardless of the ghost tags
+unsigned int AllocateDataBuf(unsigned int logicalSliceAddr)
+{
+	unsigned int evictedEntry, ghostEntry, listNo, streamNo;
+
+	evictedEntry = SelectVictimDataBuf();
 	if(evictedEntry == DATA_BUF_NONE)
 		assert(!"[WARNING] There is no valid buffer entry [WARNING]");
 
-	if(dataBufMapPtr->dataBuf[evictedEntry].prevEntry != DATA_BUF_NONE)
-	{
-		dataBufMapPtr->dataBuf[dataBufMapPtr->dataBuf[evictedEntry].prevEntry].nextEntry = DATA_BUF_NONE;
-		dataBufLruList.tailEntry = dataBufMapPtr->dataBuf[evictedEntry].prevEntry;
+	SelectiveGetFromDataBufList(evictedEntry);
+	SelectiveGetFromDataBufHashList(evictedEntry);
 
-		dataBufMapPtr->dataBuf[evictedEntry].prevEntry = DATA_BUF_NONE;
-		dataBufMapPtr->dataBuf[evictedEntry].nextEntry = dataBufLruList.headEntry;
-		dataBufMapPtr->dataBuf[dataBufLruList.headEntry].prevEntry = evictedEntry;
-		dataBufLruList.headEntry = evictedEntry;
+	if(dataBufMapPtr->dataBuf[evictedEntry].logicalSliceAddr != LSA_NONE)
+	{
+		ghostEntry = FindDataBufGhostTableEntry(dataBufMapPtr->dataBuf[evictedEntry].logicalSliceAddr);
+		dataBufGhostTable.logicalSliceAddr[dataBufMapPtr->dataBuf[evictedEntry].list][ghostEntry] = dataBufMapPtr->dataBuf[evictedEntry].logicalSliceAddr;
+	}
 
+	if(dataBufMapPtr->dataBuf[evictedEntry].prefetched == DATA_BUF_PREFETCHED)
+	{
+		streamNo = dataBufMapPtr->dataBuf[evictedEntry].streamNo;
+		if(readStreamTable.stream[streamNo].depth > READ_AHEAD_MIN_DEPTH)
+			readStreamTable.stream[streamNo].depth /= 2;
+		if(readStreamTable.stream[streamNo].depth < READ_AHEAD_MIN_DEPTH)
+			readStreamTable.stream[streamNo].depth = READ_AHEAD_MIN_DEPTH;
+
+		dataBufMapPtr->dataBuf[evictedEntry].prefetched = DATA_BUF_NOT_PREFETCHED;
+		readStreamTable.prefetchUnusedCnt++;
 	}
-	else
+
+	//a slice evicted not long ago comes back, its ghost tag tells which list gave it up too early
+	listNo = DATA_BUF_LIST_PROBATION;
+	if(logicalSliceAddr != LSA_NONE)
 	{
-		dataBufMapPtr->dataBuf[evictedEntry].prevEntry = DATA_BUF_NONE;
-		dataBufMapPtr->dataBuf[evictedEntry].nextEntry = DATA_BUF_NONE;
-		dataBufLruList.headEntry = evictedEntry;
-		dataBufLruList.tailEntry = evictedEntry;
+		ghostEntry = FindDataBufGhostTableEntry(logicalSliceAddr);
+		if(dataBufGhostTable.logicalSliceAddr[DATA_BUF_LIST_PROBATION][ghostEntry] == logicalSliceAddr)
+		{
+			dataBufGhostTable.logicalSliceAddr[DATA_BUF_LIST_PROBATION][ghostEntry] = LSA_NONE;
+			if(dataBufProbationTarget < DATA_BUF_PROBATION_TARGET_MAX)
+				dataBufProbationTarget++;
+			listNo = DATA_BUF_LIST_PROTECTED;
+		}
+		else if(dataBufGhostTable.logicalSliceAddr[DATA_BUF_LIST_PROTECTED][ghostEntry] == logicalSliceAddr)
+		{
+			dataBufGhostTable.logicalSliceAddr[DATA_BUF_LIST_PROTECTED][ghostEntry] = LSA_NONE;
+			if(dataBufProbationTarget > DATA_BUF_PROBATION_TARGET_MIN)
+				dataBufProbationTarget--;
+			listNo = DATA_BUF_LIST_PROTECTED;
+		}
 	}
 
-	SelectiveGetFromDataBufHashList(evictedEntry);
+	PutToDataBufList(evictedEntry, listNo);
 
 	return evictedEntry;
 }
 
+// looks up a slice without touching the lru order
+// only the ftl updates the index, another core may call this without a lock and gets either the old or the new mapping
+unsigned int FindDataBuf(unsigned int logicalSliceAddr)
+{
+	P_DATA_BUF_HASH_BUCKET bucket;
+	unsigned int homeBucketNo, bucketNo, slotNo, bufEntry, tag, overflowCnt, probeCnt;
+
+	homeBucketNo = FindDataBufHashBucket(logicalSliceAddr);
+	bucketNo = homeBucketNo;
+	overflowCnt = 0;
+	probeCnt = 0;
+
+	while(1)
+	{
+		bucket = &dataBufHashTablePtr->dataBufHash[bucketNo];
+
+		for(slotNo = 0; slotNo < DATA_BUF_HASH_SLOTS_PER_BUCKET; slotNo++)
+		{
+			tag = bucket->slot[slotNo].logicalSliceAddr;
+			if(tag == logicalSliceAddr)
+			{
+				dmb();
+				bufEntry = bucket->slot[slotNo].bufEntry;
+				dmb();
+
+				//the slot was reused while it was read
+				if(bucket->slot[slotNo].logicalSliceAddr == logicalSliceAddr)
+					return bufEntry;
+			}
+			else if((bucketNo != homeBucketNo) && (tag != LSA_NONE) && (FindDataBufHashBucket(tag) == homeBucketNo))
+				probeCnt++;
+		}
+
+		if(bucketNo == homeBucketNo)
+			overflowCnt = bucket->overflowCnt;
+
+		if(probeCnt >= overflowCnt)
+			return DATA_BUF_FAIL;
+
+		bucketNo = FindDataBufHashBucket(bucketNo + 1);
+		if(bucketNo == homeBucketNo)
+			return DATA_BUF_FAIL;
+	}
+}
+
+void UpdateReadStream(unsigned int logicalSliceAddr)
+{
+	unsigned int streamNo;
+
+	for(streamNo = 0; streamNo < READ_STREAM_COUNT; streamNo++)
+		if(readStreamTable.stream[streamNo].nextLsa == logicalSliceAddr)
+		{
+			readStreamTable.stream[streamNo].nextLsa = logicalSliceAddr + 1;
+			if(readStreamTable.stream[streamNo].seqCnt < READ_STREAM_DETECT_THRESHOLD)
+				readStreamTable.stream[streamNo].seqCnt++;
+
+			return;
+		}
+		else if(readStreamTable.stream[streamNo].nextLsa - 1 == logicalSliceAddr)
+		{
+			//another read within the slice the stream is at, e.g. 4KB reads of a 16KB slice
+			return;
+		}
+
+	//not a continuation of any stream, replace the streams round-robin
+	streamNo = readStreamTable.replaceStreamNo;
+	readStreamTable.replaceStreamNo = (streamNo + 1) % READ_STREAM_COUNT;
+
+	readStreamTable.stream[streamNo].nextLsa = logicalSliceAddr + 1;
+	readStreamTable.stream[streamNo].prefetchLsa = logicalSliceAddr + 1;
+	readStreamTable.stream[streamNo].seqCnt = 1;
+	readStreamTable.stream[streamNo].depth = READ_AHEAD_MIN_DEPTH;
+}
+
+void CheckPrefetchedDataBufHit(unsigned int bufEntry, unsigned int reqCode)
+{
+	unsigned int streamNo;
+
+	if(dataBufMapPtr->dataBuf[bufEntry].prefetched == DATA_BUF_NOT_PREFETCHED)
+		return;
+
+	if(reqCode == REQ_CODE_READ)
+	{
+		streamNo = dataBufMapPtr->dataBuf[bufEntry].streamNo;
+		if(readStreamTable.stream[streamNo].depth < READ_AHEAD_MAX_DEPTH)
+			readStreamTable.stream[streamNo].depth++;
+
+		readStreamTable.prefetchHitCnt++;
+	}
+
+	dataBufMapPtr->dataBuf[bufEntry].prefetched = DATA_BUF_NOT_PREFETCHED;
+}
+
 
 void UpdateDataBufEntryInfoBlockingReq(unsigned int bufEntry, unsigned int reqSlotTag)
 {
@@ -185,9 +415,15 @@ void UpdateDataBufEntryInfoBlockingReq(unsigned int bufEntry, unsigned int reqSl
 }
 
 
+// entries of a die are handed out in turn, a reused entry orders its new requests behind the previous copy by buffer dependency
 unsigned int AllocateTempDataBuf(unsigned int dieNo)
 {
-	return dieNo;
+	unsigned int bufEntry;
+
+	bufEntry = dieNo * TEMPORARY_DATA_BUFFER_ENTRY_COUNT_PER_DIE + tempDataBufMapPtr->nextEntryOfDie[dieNo];
+	tempDataBufMapPtr->nextEntryOfDie[dieNo] = (tempDataBufMapPtr->nextEntryOfDie[dieNo] + 1) % TEMPORARY_DATA_BUFFER_ENTRY_COUNT_PER_DIE;
+
+	return bufEntry;
 }
 
 
@@ -203,62 +439,95 @@ void UpdateTempDataBufEntryInfoBlockingReq(unsigned int bufEntry, unsigned int r
 	tempDataBufMapPtr->tempDataBuf[bufEntry].blockingReqTail = reqSlotTag;
 }
 
-void PutToDataBufHashList(unsigned int bufEntry)
+// bypass entries are handed out in ring order, an entry is reusable once its last request has completed
+unsigned int AllocateBypassDataBuf()
 {
-	unsigned int hashEntry;
+	unsigned int bufEntry;
+
+	bufEntry = bypassDataBufMapPtr->nextEntry;
+	if(bypassDataBufMapPtr->bypassDataBuf[bufEntry].blockingReqTail != REQ_SLOT_TAG_NONE)
+		return DATA_BUF_FAIL;
 
-	hashEntry = FindDataBufHashTableEntry(dataBufMapPtr->dataBuf[bufEntry].logicalSliceAddr);
+	bypassDataBufMapPtr->nextEntry = (bufEntry + 1) % AVAILABLE_BYPASS_DATA_BUFFER_ENTRY_COUNT;
+
+	return bufEntry;
+}
 
-	if(dataBufHashTablePtr->dataBufHash[hashEntry].tailEntry != DATA_BUF_NONE)
+
+void UpdateBypassDataBufEntryInfoBlockingReq(unsigned int bufEntry, unsigned int reqSlotTag)
+{
+	if(bypassDataBufMapPtr->bypassDataBuf[bufEntry].blockingReqTail != REQ_SLOT_TAG_NONE)
 	{
-		dataBufMapPtr->dataBuf[bufEntry].hashPrevEntry = dataBufHashTablePtr->dataBufHash[hashEntry].tailEntry ;
-		dataBufMapPtr->dataBuf[bufEntry].hashNextEntry = REQ_SLOT_TAG_NONE;
-		dataBufMapPtr->dataBuf[dataBufHashTablePtr->dataBufHash[hashEntry].tailEntry].hashNextEntry = bufEntry;
-		dataBufHashTablePtr->dataBufHash[hashEntry].tailEntry = bufEntry;
+		reqPoolPtr->reqPool[reqSlotTag].prevBlockingReq = bypassDataBufMapPtr->bypassDataBuf[bufEntry].blockingReqTail;
+		reqPoolPtr->reqPool[reqPoolPtr->reqPool[reqSlotTag].prevBlockingReq].nextBlockingReq  = reqSlotTag;
 	}
-	else
+
+	bypassDataBufMapPtr->bypassDataBuf[bufEntry].blockingReqTail = reqSlotTag;
+}
+
+void PutToDataBufHashList(unsigned int bufEntry)
+{
+	P_DATA_BUF_HASH_BUCKET bucket;
+	unsigned int logicalSliceAddr, homeBucketNo, bucketNo, slotNo;
+
+	logicalSliceAddr = dataBufMapPtr->dataBuf[bufEntry].logicalSliceAddr;
+	homeBucketNo = FindDataBufHashBucket(logicalSliceAddr);
+	bucketNo = homeBucketNo;
+
+	do
 	{
-		dataBufMapPtr->dataBuf[bufEntry].hashPrevEntry = REQ_SLOT_TAG_NONE;
-		dataBufMapPtr->dataBuf[bufEntry].hashNextEntry = REQ_SLOT_TAG_NONE;
-		dataBufHashTablePtr->dataBufHash[hashEntry].headEntry = bufEntry;
-		dataBufHashTablePtr->dataBufHash[hashEntry].tailEntry = bufEntry;
-	}
+		bucket = &dataBufHashTablePtr->dataBufHash[bucketNo];
+
+		for(slotNo = 0; slotNo < DATA_BUF_HASH_SLOTS_PER_BUCKET; slotNo++)
+			if(bucket->slot[slotNo].logicalSliceAddr == LSA_NONE)
+			{
+				if(bucketNo != homeBucketNo)
+					dataBufHashTablePtr->dataBufHash[homeBucketNo].overflowCnt++;
+
+				//publish the entry before the tag, a lock-free reader never sees a tag without its entry
+				bucket->slot[slotNo].bufEntry = bufEntry;
+				dmb();
+				bucket->slot[slotNo].logicalSliceAddr = logicalSliceAddr;
+
+				return;
+			}
+
+		bucketNo = FindDataBufHashBucket(bucketNo + 1);
+	} while(bucketNo != homeBucketNo);
+
+	assert(!"[WARNING] There is no empty slot in data buffer hash table [WARNING]");
 }
 
 
 void SelectiveGetFromDataBufHashList(unsigned int bufEntry)
 {
-	if(dataBufMapPtr->dataBuf[bufEntry].logicalSliceAddr != LSA_NONE)
-	{
-		unsigned int prevBufEntry, nextBufEntry, hashEntry;
+	P_DATA_BUF_HASH_BUCKET bucket;
+	unsigned int logicalSliceAddr, homeBucketNo, bucketNo, slotNo;
 
-		prevBufEntry =  dataBufMapPtr->dataBuf[bufEntry].hashPrevEntry;
-		nextBufEntry =  dataBufMapPtr->dataBuf[bufEntry].hashNextEntry;
-		hashEntry = FindDataBufHashTableEntry(dataBufMapPtr->dataBuf[bufEntry].logicalSliceAddr);
+	logicalSliceAddr = dataBufMapPtr->dataBuf[bufEntry].logicalSliceAddr;
+	if(logicalSliceAddr == LSA_NONE)
+		return;
 
-		if((nextBufEntry != DATA_BUF_NONE) && (prevBufEntry != DATA_BUF_NONE))
-		{
-			dataBufMapPtr->dataBuf[prevBufEntry].hashNextEntry = nextBufEntry;
-			dataBufMapPtr->dataBuf[nextBufEntry].hashPrevEntry = prevBufEntry;
-		}
-		else if((nextBufEntry == DATA_BUF_NONE) && (prevBufEntry != DATA_BUF_NONE))
-		{
-			dataBufMapPtr->dataBuf[prevBufEntry].hashNextEntry = DATA_BUF_NONE;
-			dataBufHashTablePtr->dataBufHash[hashEntry].tailEntry = prevBufEntry;
-		}
-		else if((nextBufEntry != DATA_BUF_NONE) && (prevBufEntry == DATA_BUF_NONE))
-		{
-			dataBufMapPtr->dataBuf[nextBufEntry].hashPrevEntry = DATA_BUF_NONE;
-			dataBufHashTablePtr->dataBufHash[hashEntry].headEntry = nextBufEntry;
-		}
-		else
-		{
-			dataBufHashTablePtr->dataBufHash[hashEntry].headEntry = DATA_BUF_NONE;
-			dataBufHashTablePtr->dataBufHash[hashEntry].tailEntry = DATA_BUF_NONE;
-		}
-	}
-}
+	homeBucketNo = FindDataBufHashBucket(logicalSliceAddr);
+	bucketNo = homeBucketNo;
 
+	do
+	{
+		bucket = &dataBufHashTablePtr->dataBufHash[bucketNo];
 
+		for(slotNo = 0; slotNo < DATA_BUF_HASH_SLOTS_PER_BUCKET; slotNo++)
+			if((bucket->slot[slotNo].logicalSliceAddr == logicalSliceAddr) && (bucket->slot[slotNo].bufEntry == bufEntry))
+			{
+				bucket->slot[slotNo].logicalSliceAddr = LSA_NONE;
+				dmb();
 
+				if(bucketNo != homeBucketNo)
+					dataBufHashTablePtr->dataBufHash[homeBucketNo].overflowCnt--;
+
+				return;
+			}
+
+		bucketNo = FindDataBufHashBucket(bucketNo + 1);
+	} while(bucketNo != homeBucketNo);
+}
 
@@ -50,14 +50,81 @@
 #include "ftl_config.h"
 
 #define AVAILABLE_DATA_BUFFER_ENTRY_COUNT				(16 * USER_DIES)
-#define AVAILABLE_TEMPORARY_DATA_BUFFER_ENTRY_COUNT		(USER_DIES)
+// gc copies of a die rotate over this many temporary entries, so reads and programs of consecutive pages overlap
+#define TEMPORARY_DATA_BUFFER_ENTRY_COUNT_PER_DIE		4
+#define AVAILABLE_TEMPORARY_DATA_BUFFER_ENTRY_COUNT		(USER_DIES * TEMPORARY_DATA_BUFFER_ENTRY_COUNT_PER_DIE)
+#define AVAILABLE_BYPASS_DATA_BUFFER_ENTRY_COUNT		(2 * USER_DIES)
+
+// nvme blocks of a slice holding current data, a partial write leaves the rest to be merged from nand on demand
+#define DATA_BUF_VALID_ALL	((1 << NVME_BLOCKS_PER_SLICE) - 1)
+#define DATA_BUF_VALID_MASK(nvmeBlockOffset, numOfNvmeBlock) ((((1 << (numOfNvmeBlock)) - 1) << (nvmeBlockOffset)) & DATA_BUF_VALID_ALL)
+
+#if (NVME_BLOCKS_PER_SLICE > 8)
+#error "DATA_BUF_ENTRY.validMask holds at most 8 nvme blocks per slice"
+#endif
+
+// read commands this large stream through the bypass ring instead of entering the data buffer
+#define BYPASS_READ_MIN_NVME_BLOCKS	(8 * NVME_BLOCKS_PER_SLICE)
 
 #define DATA_BUF_NONE	0xffff
 #define DATA_BUF_FAIL	0xffff
 #define DATA_BUF_DIRTY	1
 #define DATA_BUF_CLEAN	0
 
-#define FindDataBufHashTableEntry(logicalSliceAddr) ((logicalSliceAddr) % AVAILABLE_DATA_BUFFER_ENTRY_COUNT)
+// 2Q replacement, new entries start on probation and move to the protected list when referenced again
+#define DATA_BUF_LIST_PROBATION		0
+#define DATA_BUF_LIST_PROTECTED		1
+#define DATA_BUF_LIST_COUNT			2
+
+// target size of the probation list, adapted by hits on the ghost tags of evicted entries
+#define DATA_BUF_PROBATION_TARGET_INIT	(AVAILABLE_DATA_BUFFER_ENTRY_COUNT / 4)
+#define DATA_BUF_PROBATION_TARGET_MIN	(AVAILABLE_DATA_BUFFER_ENTRY_COUNT / 16)
+#define DATA_BUF_PROBATION_TARGET_MAX	(AVAILABLE_DATA_BUFFER_ENTRY_COUNT - DATA_BUF_PROBATION_TARGET_MIN)
+
+// the destager keeps this many entries at the tail of each list clean so that an allocation does not wait for a nand program
+#define DATA_BUF_CLEAN_WATERMARK		(2 * USER_DIES)
+// the destager runs only while fewer nand requests than this are outstanding, that is while some dies are idle
+#define DATA_BUF_DESTAGE_NAND_REQ_LIMIT	(USER_DIES)
+
+#define DATA_BUF_PREFETCHED		1
+#define DATA_BUF_NOT_PREFETCHED	0
+
+// sequential read streams tracked at the same time, at most 4 (DATA_BUF_ENTRY.streamNo)
+#define READ_STREAM_COUNT			4
+// sequential slices a stream reads before its next slices are prefetched
+#define READ_STREAM_DETECT_THRESHOLD	2
+// slices prefetched ahead of a stream, grows on prefetch hits and shrinks when prefetched entries are evicted unused
+#define READ_AHEAD_MIN_DEPTH		2
+#define READ_AHEAD_MAX_DEPTH		(2 * USER_DIES)
+
+// open addressing index, one bucket per cache line and a power-of-two bucket count so that hashing is a mask
+// the bucket count is the next power of two that keeps the table loaded at most 50%, it follows AVAILABLE_DATA_BUFFER_ENTRY_COUNT
+#define DATA_BUF_HASH_SLOTS_PER_BUCKET	7
+#define DATA_BUF_HASH_MIN_BUCKET_COUNT	((2 * AVAILABLE_DATA_BUFFER_ENTRY_COUNT + DATA_BUF_HASH_SLOTS_PER_BUCKET - 1) / DATA_BUF_HASH_SLOTS_PER_BUCKET)
+#define DATA_BUF_HASH_BUCKET_COUNT		((DATA_BUF_HASH_MIN_BUCKET_COUNT <= 16) ? 16 : \
+										(DATA_BUF_HASH_MIN_BUCKET_COUNT <= 32) ? 32 : \
+										(DATA_BUF_HASH_MIN_BUCKET_COUNT <= 64) ? 64 : \
+										(DATA_BUF_HASH_MIN_BUCKET_COUNT <= 128) ? 128 : \
+										(DATA_BUF_HASH_MIN_BUCKET_COUNT <= 256) ? 256 : \
+										(DATA_BUF_HASH_MIN_BUCKET_COUNT <= 512) ? 512 : \
+										(DATA_BUF_HASH_MIN_BUCKET_COUNT <= 1024) ? 1024 : \
+										(DATA_BUF_HASH_MIN_BUCKET_COUNT <= 2048) ? 2048 : \
+										(DATA_BUF_HASH_MIN_BUCKET_COUNT <= 4096) ? 4096 : \
+										(DATA_BUF_HASH_MIN_BUCKET_COUNT <= 8192) ? 8192 : \
+										(DATA_BUF_HASH_MIN_BUCKET_COUNT <= 16384) ? 16384 : 32768)
+#define DATA_BUF_GHOST_ENTRY_COUNT		(4 * DATA_BUF_HASH_BUCKET_COUNT)
+
+#if ((DATA_BUF_HASH_BUCKET_COUNT & (DATA_BUF_HASH_BUCKET_COUNT - 1)) != 0)
+#error "DATA_BUF_HASH_BUCKET_COUNT must be a power of two"
+#endif
+#if (2 * AVAILABLE_DATA_BUFFER_ENTRY_COUNT > DATA_BUF_HASH_BUCKET_COUNT * DATA_BUF_HASH_SLOTS_PER_BUCKET)
+#error "data buffer hash table is loaded over 50%, too many data buffer entries"
+#endif
+
+#define FindDataBufHashBucket(logicalSliceAddr) ((logicalSliceAddr) & (DATA_BUF_HASH_BUCKET_COUNT - 1))
+#define FindDataBufGhostTableEntry(logicalSliceAddr) ((logicalSliceAddr) & (DATA_BUF_GHOST_ENTRY_COUNT - 1))
+
+// #define DATA_BUF_LOOKUP_PROFILE
 
 
 typedef struct _DATA_BUF_ENTRY {
@@ -65,32 +132,63 @@ typedef struct _DATA_BUF_ENTRY {
 	unsigned int prevEntry : 16;
 	unsigned int nextEntry : 16;
 	unsigned int blockingReqTail : 16;
-	unsigned int hashPrevEntry : 16;
-	unsigned int hashNextEntry : 16;
 	unsigned int dirty : 1;
-	unsigned int reserved0 : 15;
+	unsigned int prefetched : 1;
+	unsigned int streamNo : 2;
+	unsigned int list : 1;
+	unsigned int reserved0 : 11;
+	unsigned int validMask : 8;
+	unsigned int mergeMask : 8;		// blocks taken from the merge buffer when the merge read completes
+	unsigned int mergeEntry : 16;	// bypass entry used as the merge buffer
 } DATA_BUF_ENTRY, *P_DATA_BUF_ENTRY;
 
 typedef struct _DATA_BUF_MAP{
 	DATA_BUF_ENTRY dataBuf[AVAILABLE_DATA_BUFFER_ENTRY_COUNT];
-} DATA_BUF_MAP, *P_DATA_BUF_MAP;
+} __attribute__((aligned(BYTES_PER_CACHE_LINE))) DATA_BUF_MAP, *P_DATA_BUF_MAP;
 
 typedef struct _DATA_BUF_LRU_LIST {
 	unsigned int headEntry : 16;
 	unsigned int tailEntry : 16;
+	unsigned int entryCnt;
 } DATA_BUF_LRU_LIST, *P_DATA_BUF_LRU_LIST;
 
-typedef struct _DATA_BUF_HASH_ENTRY{
-	unsigned int headEntry : 16;
-	unsigned int tailEntry : 16;
-} DATA_BUF_HASH_ENTRY, *P_DATA_BUF_HASH_ENTRY;
+// logical slice addresses recently evicted from each list, direct mapped
+typedef struct _DATA_BUF_GHOST_TABLE {
+	unsigned int logicalSliceAddr[DATA_BUF_LIST_COUNT][DATA_BUF_GHOST_ENTRY_COUNT];
+} DATA_BUF_GHOST_TABLE, *P_DATA_BUF_GHOST_TABLE;
+
+// logicalSliceAddr is the tag, LSA_NONE marks an empty slot
+typedef struct _DATA_BUF_HASH_SLOT{
+	volatile unsigned int logicalSliceAddr;
+	volatile unsigned int bufEntry;
+} DATA_BUF_HASH_SLOT, *P_DATA_BUF_HASH_SLOT;
 
+typedef struct _DATA_BUF_HASH_BUCKET{
+	DATA_BUF_HASH_SLOT slot[DATA_BUF_HASH_SLOTS_PER_BUCKET];
+	volatile unsigned int overflowCnt;		// slices of this bucket placed in the following buckets
+	unsigned int reserved0;
+} __attribute__((aligned(BYTES_PER_CACHE_LINE))) DATA_BUF_HASH_BUCKET, *P_DATA_BUF_HASH_BUCKET;
 
 typedef struct _DATA_BUF_HASH_TABLE{
-	DATA_BUF_HASH_ENTRY dataBufHash[AVAILABLE_DATA_BUFFER_ENTRY_COUNT];
+	DATA_BUF_HASH_BUCKET dataBufHash[DATA_BUF_HASH_BUCKET_COUNT];
 } DATA_BUF_HASH_TABLE, *P_DATA_BUF_HASH_TABLE;
 
 
+typedef struct _READ_STREAM_ENTRY {
+	unsigned int nextLsa;
+	unsigned int prefetchLsa;
+	unsigned int seqCnt : 16;
+	unsigned int depth : 16;
+} READ_STREAM_ENTRY, *P_READ_STREAM_ENTRY;
+
+typedef struct _READ_STREAM_TABLE {
+	READ_STREAM_ENTRY stream[READ_STREAM_COUNT];
+	unsigned int replaceStreamNo;
+	unsigned int prefetchCnt;
+	unsigned int prefetchHitCnt;
+	unsigned int prefetchUnusedCnt;
+} READ_STREAM_TABLE, *P_READ_STREAM_TABLE;
+
 typedef struct _TEMPORARY_DATA_BUF_ENTRY {
 	unsigned int blockingReqTail : 16;
 	unsigned int reserved0 : 16;
@@ -98,22 +196,52 @@ typedef struct _TEMPORARY_DATA_BUF_ENTRY {
 
 typedef struct _TEMPORARY_DATA_BUF_MAP{
 	TEMPORARY_DATA_BUF_ENTRY tempDataBuf[AVAILABLE_TEMPORARY_DATA_BUFFER_ENTRY_COUNT];
+	unsigned char nextEntryOfDie[USER_DIES];
 } TEMPORARY_DATA_BUF_MAP, *P_TEMPORARY_DATA_BUF_MAP;
 
+typedef struct _BYPASS_DATA_BUF_ENTRY {
+	unsigned int blockingReqTail : 16;
+	unsigned int reserved0 : 16;
+} BYPASS_DATA_BUF_ENTRY, *P_BYPASS_DATA_BUF_ENTRY;
+
+typedef struct _BYPASS_DATA_BUF_MAP{
+	BYPASS_DATA_BUF_ENTRY bypassDataBuf[AVAILABLE_BYPASS_DATA_BUFFER_ENTRY_COUNT];
+	unsigned int nextEntry;
+} BYPASS_DATA_BUF_MAP, *P_BYPASS_DATA_BUF_MAP;
+
 void InitDataBuf();
 unsigned int CheckDataBufHit(unsigned int reqSlotTag);
-unsigned int AllocateDataBuf();
+unsigned int SelectVictimDataBuf();
+unsigned int AllocateDataBuf(unsigned int logicalSliceAddr);
+void PutToDataBufList(unsigned int bufEntry, unsigned int listNo);
+void SelectiveGetFromDataBufList(unsigned int bufEntry);
 void UpdateDataBufEntryInfoBlockingReq(unsigned int bufEntry, unsigned int reqSlotTag);
 
 unsigned int AllocateTempDataBuf(unsigned int dieNo);
 void UpdateTempDataBufEntryInfoBlockingReq(unsigned int bufEntry, unsigned int reqSlotTag);
 
+unsigned int AllocateBypassDataBuf();
+void UpdateBypassDataBufEntryInfoBlockingReq(unsigned int bufEntry, unsigned int reqSlotTag);
+
+unsigned int FindDataBuf(unsigned int logicalSliceAddr);
+void UpdateReadStream(unsigned int logicalSliceAddr);
+void CheckPrefetchedDataBufHit(unsigned int bufEntry, unsigned int reqCode);
+
 void PutToDataBufHashList(unsigned int bufEntry);
 void SelectiveGetFromDataBufHashList(unsigned int bufEntry);
 
 extern P_DATA_BUF_MAP dataBufMapPtr;
-extern DATA_BUF_LRU_LIST dataBufLruList;
-extern P_DATA_BUF_HASH_TABLE dataBufHashTable;
+extern DATA_BUF_LRU_LIST dataBufLruList[DATA_BUF_LIST_COUNT];
+extern DATA_BUF_GHOST_TABLE dataBufGhostTable;
+extern unsigned int dataBufProbationTarget;
+extern unsigned int dataBufHitCnt;
+extern unsigned int dataBufMissCnt;
+extern unsigned int dataBufPartialWriteCnt;
+extern unsigned int dataBufMergeReadCnt;
+extern P_DATA_BUF_HASH_TABLE dataBufHashTablePtr;
 extern P_TEMPORARY_DATA_BUF_MAP tempDataBufMapPtr;
+extern P_BYPASS_DATA_BUF_MAP bypassDataBufMapPtr;
+extern unsigned int dirtyDataBufCnt;
+extern READ_STREAM_TABLE readStreamTable;
 
 #endif /* DATA_BUFFER_H_ */
@@ -199,6 +199,13 @@
 #define MB_PER_OVER_PROVISION_BLOCK_SPACE	((USER_BLOCKS_PER_SSD / 10) * MB_PER_BLOCK)
 
 
+//------------------------------------
+//processor specifications
+//------------------------------------
+
+#define	BYTES_PER_CACHE_LINE		64		//Cortex-A53 L1/L2 cache line
+
+
 void InitFTL();
 void InitChCtlReg();
 void InitNandArray();
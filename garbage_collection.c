@@ -49,13 +49,59 @@
 #include <assert.h>
 #include "memory_map.h"
 
+#ifdef GC_COPY_PROFILE
+#include "xtime_l.h"
+
+#define GC_COPY_PROFILE_INTERVAL	64
+#endif
+
+#ifdef GC_PACER_PROFILE
+#include "xtime_l.h"
+
+#define GC_PACER_PROFILE_WINDOW_MS	100
+
+// time the oldest queued write waited for the pacer, the latency gc pacing adds to the host writes
+static XTime tPacerHoldStart;
+static XTime pacerHoldTime;
+static XTime maxPacerHoldTime;
+#endif
+
+#ifdef WEAR_LEVELING_PROFILE
+#include "xtime_l.h"
+
+#define WEAR_LEVELING_PROFILE_PERIOD_MS	10000
+#define WEAR_LEVELING_PROFILE_BUCKETS	8
+#endif
+
+#ifdef GC_VICTIM_PROFILE
+#include "xtime_l.h"
+
+#define GC_VICTIM_PROFILE_INTERVAL	64
+#endif
+
 P_GC_VICTIM_MAP gcVictimMapPtr;
+GC_DIE_STATE_TABLE gcDieStateTable;
+GC_PACER gcPacer;
+unsigned int gcTriggered;
+unsigned int copyCnt;
+unsigned int wearLevelingCnt;
+unsigned int wearLevelingCopyCnt;
 
 void InitGcVictimMap()
 {
-	int dieNo, invalidSliceCnt;
+	int dieNo, invalidSliceCnt, wordNo;
 
 	gcVictimMapPtr = (P_GC_VICTIM_MAP) GC_VICTIM_MAP_ADDR;
+	gcTriggered = 0;
+	copyCnt = 0;
+	wearLevelingCnt = 0;
+	wearLevelingCopyCnt = 0;
+	gcPacer.credit = 0;
+	gcPacer.victimValidSliceCnt = 0;
+	gcPacer.activeDieCnt = 0;
+
+	for(dieNo=0 ; dieNo<USER_DIES; dieNo++)
+		gcDieStateTable.gcDieState[dieNo].state = GC_DIE_STATE_IDLE;
 
 	for(dieNo=0 ; dieNo<USER_DIES; dieNo++)
 	{
@@ -64,72 +110,495 @@ void InitGcVictimMap()
 			gcVictimMapPtr->gcVictimList[dieNo][invalidSliceCnt].headBlock = BLOCK_NONE;
 			gcVictimMapPtr->gcVictimList[dieNo][invalidSliceCnt].tailBlock = BLOCK_NONE;
 		}
+
+		for(wordNo=0 ; wordNo<GC_VICTIM_BITMAP_WORDS; wordNo++)
+			gcVictimMapPtr->nonEmptyListBitmap[dieNo][wordNo] = 0;
 	}
 }
 
 
 void GarbageCollection(unsigned int dieNo)
 {
-	unsigned int victimBlockNo, pageNo, virtualSliceAddr, logicalSliceAddr, dieNoForGcCopy, reqSlotTag;
+	unsigned int wearLeveling;
+
+	// foreground gc on hard exhaustion, an incremental gc of the die is finished first, it frees a block just as well
+	if(gcDieStateTable.gcDieState[dieNo].state == GC_DIE_STATE_IDLE)
+		StartGarbageCollection(dieNo);
+
+	wearLeveling = gcDieStateTable.gcDieState[dieNo].wearLeveling;
+	while(gcDieStateTable.gcDieState[dieNo].state != GC_DIE_STATE_IDLE)
+		GarbageCollectionStep(dieNo, USER_PAGES_PER_BLOCK);
+
+	// a wear leveling migration moves a block of valid data and frees about nothing, a real victim is collected as well
+	if(wearLeveling)
+	{
+		StartGarbageCollection(dieNo);
+		while(gcDieStateTable.gcDieState[dieNo].state != GC_DIE_STATE_IDLE)
+			GarbageCollectionStep(dieNo, USER_PAGES_PER_BLOCK);
+	}
+}
+
+void StartGarbageCollection(unsigned int dieNo)
+{
+	unsigned int victimBlockNo;
 
 	victimBlockNo = GetFromGcVictimList(dieNo);
-	dieNoForGcCopy = dieNo;
+	gcPacer.victimValidSliceCnt = (gcPacer.victimValidSliceCnt * 3 + SLICES_PER_BLOCK - virtualBlockMapPtr->block[dieNo][victimBlockNo].invalidSliceCnt) / 4;
 
-	if(virtualBlockMapPtr->block[dieNo][victimBlockNo].invalidSliceCnt != SLICES_PER_BLOCK)
+	StartGarbageCollectionOfBlock(dieNo, victimBlockNo, 0);
+}
+
+// the victim is already off the victim list
+void StartGarbageCollectionOfBlock(unsigned int dieNo, unsigned int victimBlockNo, unsigned int wearLeveling)
+{
+	// host writes must not land in a block that is going to be erased while the copy is spread over several rounds
+	if(victimBlockNo == virtualDieMapPtr->die[dieNo].currentBlock)
+	{
+		virtualDieMapPtr->die[dieNo].currentBlock = GetFromFbList(dieNo, GET_FREE_BLOCK_GC);
+		if(virtualDieMapPtr->die[dieNo].currentBlock == BLOCK_FAIL)
+			assert(!"[WARNING] There is no available block [WARNING]");
+	}
+	if(victimBlockNo == virtualDieMapPtr->die[dieNo].wearLevelingBlock)
+		virtualDieMapPtr->die[dieNo].wearLevelingBlock = BLOCK_NONE;
+
+	// off the victim list until it is erased, InvalidateOldVsa only counts its invalid slices meanwhile
+	virtualBlockMapPtr->block[dieNo][victimBlockNo].gcVictim = 1;
+
+	gcDieStateTable.gcDieState[dieNo].victimBlock = victimBlockNo;
+	gcDieStateTable.gcDieState[dieNo].nextPage = 0;
+	gcDieStateTable.gcDieState[dieNo].wearLeveling = wearLeveling;
+	gcDieStateTable.gcDieState[dieNo].state = GC_DIE_STATE_COPY;
+
+	gcPacer.activeDieCnt++;
+}
+
+// copies up to pageBudget valid pages of the victim from where the last round stopped, the victim is erased after its last page
+void GarbageCollectionStep(unsigned int dieNo, unsigned int pageBudget)
+{
+	unsigned int victimBlockNo, pageNo, virtualSliceAddr, logicalSliceAddr, dieNoForGcCopy, copyVirtualSliceAddr, reqSlotTag, tempDataBufEntry, copiedPageCnt;
+#ifdef GC_COPY_PROFILE
+	static XTime tReport = 0;
+	static unsigned int reportedCopyCnt = 0;
+	static XTime maxStepTime = 0;
+	static unsigned int copyCntOfDie[USER_DIES];
+	unsigned int dieNoForReport;
+	XTime tStart, tNow;
+
+	XTime_GetTime(&tStart);
+#endif
+
+	victimBlockNo = gcDieStateTable.gcDieState[dieNo].victimBlock;
+	copiedPageCnt = 0;
+
+	for(pageNo = gcDieStateTable.gcDieState[dieNo].nextPage; (pageNo < USER_PAGES_PER_BLOCK) && (copiedPageCnt < pageBudget); pageNo++)
 	{
-		for(pageNo=0 ; pageNo<USER_PAGES_PER_BLOCK ; pageNo++)
+		if(virtualBlockMapPtr->block[dieNo][victimBlockNo].invalidSliceCnt == SLICES_PER_BLOCK)
 		{
-			virtualSliceAddr = Vorg2VsaTranslation(dieNo, victimBlockNo, pageNo);
-			logicalSliceAddr = virtualSliceMapPtr->virtualSlice[virtualSliceAddr].logicalSliceAddr;
+			pageNo = USER_PAGES_PER_BLOCK;
+			break;
+		}
+
+		virtualSliceAddr = Vorg2VsaTranslation(dieNo, victimBlockNo, pageNo);
+		logicalSliceAddr = virtualSliceMapPtr->virtualSlice[virtualSliceAddr].logicalSliceAddr;
 
-			if(logicalSliceAddr != LSA_NONE)
-				if(logicalSliceMapPtr->logicalSlice[logicalSliceAddr].virtualSliceAddr ==  virtualSliceAddr) //valid data
+		if(logicalSliceAddr != LSA_NONE)
+			if(logicalSliceMapPtr->logicalSlice[logicalSliceAddr].virtualSliceAddr ==  virtualSliceAddr) //valid data
+			{
+				// cold data of a wear leveling victim stays on its die in its own block, away from the hot host writes
+				// otherwise the read stays on the victim die and the program goes to the least loaded die
+				if(gcDieStateTable.gcDieState[dieNo].wearLeveling)
+				{
+					dieNoForGcCopy = dieNo;
+					copyVirtualSliceAddr = FindFreeVirtualSliceForWearLeveling(dieNoForGcCopy);
+				}
+				else
 				{
-					//read
-					reqSlotTag = GetFromFreeReqQ();
-
-					reqPoolPtr->reqPool[reqSlotTag].reqType = REQ_TYPE_NAND;
-					reqPoolPtr->reqPool[reqSlotTag].reqCode = REQ_CODE_READ;
-					reqPoolPtr->reqPool[reqSlotTag].logicalSliceAddr = logicalSliceAddr;
-					reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat = REQ_OPT_DATA_BUF_TEMP_ENTRY;
-					reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandAddr = REQ_OPT_NAND_ADDR_VSA;
-					reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandEcc = REQ_OPT_NAND_ECC_ON;
-					reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandEccWarning = REQ_OPT_NAND_ECC_WARNING_OFF;
-					reqPoolPtr->reqPool[reqSlotTag].reqOpt.rowAddrDependencyCheck = REQ_OPT_ROW_ADDR_DEPENDENCY_CHECK;
-					reqPoolPtr->reqPool[reqSlotTag].reqOpt.blockSpace = REQ_OPT_BLOCK_SPACE_MAIN;
-					reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry = AllocateTempDataBuf(dieNo);
-					UpdateTempDataBufEntryInfoBlockingReq(reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry, reqSlotTag);
-					reqPoolPtr->reqPool[reqSlotTag].nandInfo.virtualSliceAddr = virtualSliceAddr;
-
-					SelectLowLevelReqQ(reqSlotTag);
-
-					//write
-					reqSlotTag = GetFromFreeReqQ();
-
-					reqPoolPtr->reqPool[reqSlotTag].reqType = REQ_TYPE_NAND;
-					reqPoolPtr->reqPool[reqSlotTag].reqCode = REQ_CODE_WRITE;
-					reqPoolPtr->reqPool[reqSlotTag].logicalSliceAddr = logicalSliceAddr;
-					reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat = REQ_OPT_DATA_BUF_TEMP_ENTRY;
-					reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandAddr = REQ_OPT_NAND_ADDR_VSA;
-					reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandEcc = REQ_OPT_NAND_ECC_ON;
-					reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandEccWarning = REQ_OPT_NAND_ECC_WARNING_OFF;
-					reqPoolPtr->reqPool[reqSlotTag].reqOpt.rowAddrDependencyCheck = REQ_OPT_ROW_ADDR_DEPENDENCY_CHECK;
-					reqPoolPtr->reqPool[reqSlotTag].reqOpt.blockSpace = REQ_OPT_BLOCK_SPACE_MAIN;
-					reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry = AllocateTempDataBuf(dieNo);
-					UpdateTempDataBufEntryInfoBlockingReq(reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry, reqSlotTag);
-					reqPoolPtr->reqPool[reqSlotTag].nandInfo.virtualSliceAddr = FindFreeVirtualSliceForGc(dieNoForGcCopy, victimBlockNo);
-
-					logicalSliceMapPtr->logicalSlice[logicalSliceAddr].virtualSliceAddr = reqPoolPtr->reqPool[reqSlotTag].nandInfo.virtualSliceAddr;
-					virtualSliceMapPtr->virtualSlice[reqPoolPtr->reqPool[reqSlotTag].nandInfo.virtualSliceAddr].logicalSliceAddr = logicalSliceAddr;
-
-					SelectLowLevelReqQ(reqSlotTag);
+					dieNoForGcCopy = FindDieForGcCopy(dieNo);
+					if(dieNoForGcCopy == dieNo)
+						copyVirtualSliceAddr = FindFreeVirtualSliceForGc(dieNoForGcCopy, victimBlockNo);
+					else
+						copyVirtualSliceAddr = FindFreeVirtualSliceForGc(dieNoForGcCopy, BLOCK_NONE);
 				}
+
+				// the read and the program of a page share one entry, the next pages take the other entries of the die
+				tempDataBufEntry = AllocateTempDataBuf(dieNo);
+
+				//read
+				reqSlotTag = GetFromFreeReqQ();
+
+				reqPoolPtr->reqPool[reqSlotTag].reqType = REQ_TYPE_NAND;
+				reqPoolPtr->reqPool[reqSlotTag].reqCode = REQ_CODE_READ;
+				reqPoolPtr->reqPool[reqSlotTag].logicalSliceAddr = logicalSliceAddr;
+				reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat = REQ_OPT_DATA_BUF_TEMP_ENTRY;
+				reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandAddr = REQ_OPT_NAND_ADDR_VSA;
+				reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandEcc = REQ_OPT_NAND_ECC_ON;
+				reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandEccWarning = REQ_OPT_NAND_ECC_WARNING_OFF;
+				reqPoolPtr->reqPool[reqSlotTag].reqOpt.rowAddrDependencyCheck = REQ_OPT_ROW_ADDR_DEPENDENCY_CHECK;
+				reqPoolPtr->reqPool[reqSlotTag].reqOpt.blockSpace = REQ_OPT_BLOCK_SPACE_MAIN;
+				reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry = tempDataBufEntry;
+				UpdateTempDataBufEntryInfoBlockingReq(tempDataBufEntry, reqSlotTag);
+				reqPoolPtr->reqPool[reqSlotTag].nandInfo.virtualSliceAddr = virtualSliceAddr;
+
+				SelectLowLevelReqQ(reqSlotTag);
+
+				//write
+				reqSlotTag = GetFromFreeReqQ();
+
+				reqPoolPtr->reqPool[reqSlotTag].reqType = REQ_TYPE_NAND;
+				reqPoolPtr->reqPool[reqSlotTag].reqCode = REQ_CODE_WRITE;
+				reqPoolPtr->reqPool[reqSlotTag].logicalSliceAddr = logicalSliceAddr;
+				reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat = REQ_OPT_DATA_BUF_TEMP_ENTRY;
+				reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandAddr = REQ_OPT_NAND_ADDR_VSA;
+				reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandEcc = REQ_OPT_NAND_ECC_ON;
+				reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandEccWarning = REQ_OPT_NAND_ECC_WARNING_OFF;
+				reqPoolPtr->reqPool[reqSlotTag].reqOpt.rowAddrDependencyCheck = REQ_OPT_ROW_ADDR_DEPENDENCY_CHECK;
+				reqPoolPtr->reqPool[reqSlotTag].reqOpt.blockSpace = REQ_OPT_BLOCK_SPACE_MAIN;
+				reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry = tempDataBufEntry;
+				UpdateTempDataBufEntryInfoBlockingReq(tempDataBufEntry, reqSlotTag);
+				reqPoolPtr->reqPool[reqSlotTag].nandInfo.virtualSliceAddr = copyVirtualSliceAddr;
+
+				SelectLowLevelReqQ(reqSlotTag);
+
+				logicalSliceMapPtr->logicalSlice[logicalSliceAddr].virtualSliceAddr = copyVirtualSliceAddr;
+				virtualSliceMapPtr->virtualSlice[copyVirtualSliceAddr].logicalSliceAddr = logicalSliceAddr;
+				copyCnt++;
+				copiedPageCnt++;
+				if(gcDieStateTable.gcDieState[dieNo].wearLeveling)
+					wearLevelingCopyCnt++;
+#ifdef GC_COPY_PROFILE
+				copyCntOfDie[dieNoForGcCopy]++;
+#endif
+			}
+	}
+	gcDieStateTable.gcDieState[dieNo].nextPage = pageNo;
+
+#ifdef GC_COPY_PROFILE
+	XTime_GetTime(&tNow);
+	if((tNow - tStart) > maxStepTime)
+		maxStepTime = tNow - tStart;
+#endif
+
+	SpendGcCredit(copiedPageCnt);
+
+	if(pageNo < USER_PAGES_PER_BLOCK)
+		return;
+
+	// erased ahead of demand, the erase stays off the collection and the write path
+	PutToEraseWaitList(dieNo, victimBlockNo);
+	gcDieStateTable.gcDieState[dieNo].state = GC_DIE_STATE_IDLE;
+	gcPacer.activeDieCnt--;
+	gcTriggered++;
+
+	// nothing left to pace once the last collection is done, leftover credit would hold the host for good
+	if(gcPacer.activeDieCnt == 0)
+		gcPacer.credit = 0;
+
+#ifdef GC_COPY_PROFILE
+	if((gcTriggered % GC_COPY_PROFILE_INTERVAL) == 0)
+	{
+		if(tReport)
+		{
+			xil_printf("GC: %d pages copied in %d ms, longest round %d us\r\n", copyCnt - reportedCopyCnt, (unsigned int)((tNow - tReport) / (COUNTS_PER_SECOND / 1000)), (unsigned int)(maxStepTime / (COUNTS_PER_SECOND / 1000000)));
+			if(blockWriteSeq > copyCnt)
+				xil_printf("GC: write amplification %d.%02d\r\n", (unsigned int)(blockWriteSeq * 100ULL / (blockWriteSeq - copyCnt)) / 100, (unsigned int)(blockWriteSeq * 100ULL / (blockWriteSeq - copyCnt)) % 100);
+			for(dieNoForReport = 0; dieNoForReport < USER_DIES; dieNoForReport++)
+				xil_printf("GC: die %d received %d copies, %d free blocks, %d requests pending\r\n", dieNoForReport, copyCntOfDie[dieNoForReport], virtualDieMapPtr->die[dieNoForReport].freeBlockCnt,
+						notCompletedNandReqCntOfDie[Vdie2PchTranslation(dieNoForReport)][Vdie2PwayTranslation(dieNoForReport)]);
 		}
+		for(dieNoForReport = 0; dieNoForReport < USER_DIES; dieNoForReport++)
+			copyCntOfDie[dieNoForReport] = 0;
+		tReport = tNow;
+		reportedCopyCnt = copyCnt;
+		maxStepTime = 0;
 	}
+#endif
+}
+
+// a copy goes to the die with the fewest pending nand requests, another die must have enough free blocks not to need gc itself soon
+unsigned int FindDieForGcCopy(unsigned int victimDieNo)
+{
+	unsigned int dieNo, targetDieNo, reqCnt, targetReqCnt;
 
-	EraseBlock(dieNo, victimBlockNo);
+	targetDieNo = victimDieNo;
+	targetReqCnt = notCompletedNandReqCntOfDie[Vdie2PchTranslation(victimDieNo)][Vdie2PwayTranslation(victimDieNo)];
+
+	for(dieNo = 0; dieNo < USER_DIES; dieNo++)
+	{
+		if(dieNo == victimDieNo)
+			continue;
+		if(virtualDieMapPtr->die[dieNo].freeBlockCnt < GC_SOFT_FREE_BLOCK_WATERMARK)
+			continue;
+		if(gcDieStateTable.gcDieState[dieNo].state != GC_DIE_STATE_IDLE)
+			continue;
+
+		reqCnt = notCompletedNandReqCntOfDie[Vdie2PchTranslation(dieNo)][Vdie2PwayTranslation(dieNo)];
+		if((reqCnt < targetReqCnt) || ((reqCnt == targetReqCnt) && (virtualDieMapPtr->die[dieNo].freeBlockCnt > virtualDieMapPtr->die[targetDieNo].freeBlockCnt)))
+		{
+			targetDieNo = dieNo;
+			targetReqCnt = reqCnt;
+		}
+	}
+
+	return targetDieNo;
+}
+
+// one erase per die and pass, an erase occupies the die for tBERS anyway
+void EraseAheadOfDemand()
+{
+	unsigned int dieNo;
+
+	for(dieNo = 0; dieNo < USER_DIES; dieNo++)
+		if(virtualDieMapPtr->die[dieNo].eraseWaitBlockCnt)
+			if((virtualDieMapPtr->die[dieNo].freeBlockCnt < GC_PRE_ERASED_BLOCK_TARGET) || (notCompletedNandReqCntOfDie[Vdie2PchTranslation(dieNo)][Vdie2PwayTranslation(dieNo)] == 0))
+				EraseBlock(dieNo, GetFromEraseWaitList(dieNo));
 }
 
+// gc scheduler, called once per ftl pass, erases ahead of demand and keeps collections in flight on all dies that need one
+// within the global bandwidth, copies as many pages as the host writes have earned, at the full rate while the host is idle
+void IncrementalGarbageCollection(unsigned int hostIdle)
+{
+	unsigned int dieNo, pageBudget;
+#ifdef GC_PACER_PROFILE
+	static XTime tWindow = 0;
+	static unsigned int windowCopyCnt = 0;
+	static unsigned int windowHostSliceCnt = 0;
+	XTime tNow;
+
+	XTime_GetTime(&tNow);
+	if((tNow - tWindow) >= (COUNTS_PER_SECOND / 1000) * GC_PACER_PROFILE_WINDOW_MS)
+	{
+		// one line per window, write stalls next to the host and gc throughput give the latency profile over time
+		if(tWindow)
+			xil_printf("GC pacer: %d ms host %d slices gc %d pages credit %d writes held %d us longest %d us\r\n", (unsigned int)(tNow / (COUNTS_PER_SECOND / 1000)), (blockWriteSeq - windowHostSliceCnt) - (copyCnt - windowCopyCnt), copyCnt - windowCopyCnt, gcPacer.credit / GC_PACER_CREDIT_UNIT,
+					(unsigned int)(pacerHoldTime / (COUNTS_PER_SECOND / 1000000)), (unsigned int)(maxPacerHoldTime / (COUNTS_PER_SECOND / 1000000)));
+		tWindow = tNow;
+		pacerHoldTime = 0;
+		maxPacerHoldTime = 0;
+		windowCopyCnt = copyCnt;
+		windowHostSliceCnt = blockWriteSeq;
+	}
+#endif
+
+	// every copied page takes two requests, the pass is skipped rather than spinning for free requests
+	if(freeReqQ.reqCnt < FREE_REQ_HOST_FETCH_WATERMARK)
+		return;
+
+	EraseAheadOfDemand();
+
+	for(dieNo = 0; (dieNo < USER_DIES) && (gcPacer.activeDieCnt < GC_MAX_ACTIVE_DIES); dieNo++)
+		if(GC_AVAILABLE_BLOCK_COUNT(dieNo) < GC_URGENT_FREE_BLOCK_WATERMARK)
+			if(gcDieStateTable.gcDieState[dieNo].state == GC_DIE_STATE_IDLE)
+				if(CheckGcVictim(dieNo, 1))
+					StartGarbageCollection(dieNo);
+
+	if(gcPacer.activeDieCnt == 0)
+		return;
+
+	if(hostIdle)
+		pageBudget = GC_MAX_PAGES_PER_PASS;
+	else if(gcPacer.credit / GC_PACER_CREDIT_UNIT < GC_MAX_PAGES_PER_PASS)
+		pageBudget = gcPacer.credit / GC_PACER_CREDIT_UNIT;
+	else
+		pageBudget = GC_MAX_PAGES_PER_PASS;
+
+	// the pass budget is shared by the collecting dies
+	pageBudget = (pageBudget + gcPacer.activeDieCnt - 1) / gcPacer.activeDieCnt;
+	if(pageBudget > GC_PAGES_PER_ROUND)
+		pageBudget = GC_PAGES_PER_ROUND;
+	else if(pageBudget < GC_PACER_MIN_PAGES_PER_ROUND)
+		pageBudget = GC_PACER_MIN_PAGES_PER_ROUND;
+
+	for(dieNo = 0; dieNo < USER_DIES; dieNo++)
+		if(gcDieStateTable.gcDieState[dieNo].state != GC_DIE_STATE_IDLE)
+			if(notCompletedNandReqCntOfDie[Vdie2PchTranslation(dieNo)][Vdie2PwayTranslation(dieNo)] < GC_DIE_QUEUE_DEPTH)
+				GarbageCollectionStep(dieNo, pageBudget);
+}
+
+// called for every host written slice while a collection is in progress
+void EarnGcCredit()
+{
+	unsigned int validSliceCnt;
+
+	if(gcPacer.activeDieCnt == 0)
+		return;
+
+	validSliceCnt = gcPacer.victimValidSliceCnt;
+	if(validSliceCnt >= SLICES_PER_BLOCK)
+		validSliceCnt = SLICES_PER_BLOCK - 1;
+
+	gcPacer.credit += GC_PACER_CREDIT_UNIT * validSliceCnt / (SLICES_PER_BLOCK - validSliceCnt);
+}
+
+void SpendGcCredit(unsigned int copiedPageCnt)
+{
+	if(gcPacer.credit > copiedPageCnt * GC_PACER_CREDIT_UNIT)
+		gcPacer.credit -= copiedPageCnt * GC_PACER_CREDIT_UNIT;
+	else
+		gcPacer.credit = 0;
+}
+
+// host writes are admitted only while gc keeps pace with them, the bucket absorbs bursts
+unsigned int CheckGcPacerAdmit()
+{
+#ifdef GC_PACER_PROFILE
+	XTime tNow;
+
+	XTime_GetTime(&tNow);
+	if(gcPacer.credit >= GC_PACER_MAX_CREDIT)
+	{
+		if(tPacerHoldStart == 0)
+			tPacerHoldStart = tNow;
+		return 0;
+	}
+
+	if(tPacerHoldStart)
+	{
+		pacerHoldTime += tNow - tPacerHoldStart;
+		if((tNow - tPacerHoldStart) > maxPacerHoldTime)
+			maxPacerHoldTime = tNow - tPacerHoldStart;
+		tPacerHoldStart = 0;
+	}
+
+	return 1;
+#else
+	return (gcPacer.credit < GC_PACER_MAX_CREDIT);
+#endif
+}
+
+
+unsigned int CheckGcVictim(unsigned int dieNo, unsigned int minInvalidSliceCnt)
+{
+	unsigned int invalidSliceCnt;
+
+	invalidSliceCnt = FindGcVictimList(dieNo, SLICES_PER_BLOCK);
+
+	return (invalidSliceCnt && (invalidSliceCnt >= minInvalidSliceCnt));
+}
+
+// called by the ftl while no host command is pending, starts collecting on every idle die below the soft watermark
+void BackgroundGarbageCollection()
+{
+	static unsigned int gcTargetDie = 0;
+	unsigned int dieCnt, dieNo;
+
+	if(freeReqQ.reqCnt < FREE_REQ_HOST_FETCH_WATERMARK)
+		return;
+
+	for(dieCnt = 0; (dieCnt < USER_DIES) && (gcPacer.activeDieCnt < GC_MAX_ACTIVE_DIES); dieCnt++)
+	{
+		dieNo = gcTargetDie;
+		gcTargetDie = (gcTargetDie + 1) % USER_DIES;
+
+		if(GC_AVAILABLE_BLOCK_COUNT(dieNo) >= GC_SOFT_FREE_BLOCK_WATERMARK)
+			continue;
+		if(gcDieStateTable.gcDieState[dieNo].state != GC_DIE_STATE_IDLE)
+			continue;
+		if(notCompletedNandReqCntOfDie[Vdie2PchTranslation(dieNo)][Vdie2PwayTranslation(dieNo)])
+			continue;
+		if(!CheckGcVictim(dieNo, GC_BACKGROUND_MIN_INVALID_SLICES))
+			continue;
+
+		StartGarbageCollection(dieNo);
+	}
+}
+
+// migrates a full block far less worn than its die, its cold data moves on and the block returns to the free pool
+// called by the ftl while no host command is pending, looks at one die per call
+void StaticWearLeveling()
+{
+	static unsigned int wlTargetDie = 0;
+	unsigned int dieNo, blockNo, scanCnt;
+
+	dieNo = wlTargetDie;
+	wlTargetDie = (wlTargetDie + 1) % USER_DIES;
+
+#ifdef WEAR_LEVELING_PROFILE
+	ReportWearLeveling();
+#endif
+
+	if(freeReqQ.reqCnt < FREE_REQ_HOST_FETCH_WATERMARK)
+		return;
+	if(gcPacer.activeDieCnt >= GC_MAX_ACTIVE_DIES)
+		return;
+	if(gcDieStateTable.gcDieState[dieNo].state != GC_DIE_STATE_IDLE)
+		return;
+	if(notCompletedNandReqCntOfDie[Vdie2PchTranslation(dieNo)][Vdie2PwayTranslation(dieNo)])
+		return;
+	if(GC_AVAILABLE_BLOCK_COUNT(dieNo) < GC_SOFT_FREE_BLOCK_WATERMARK)
+		return;
+	if(virtualDieMapPtr->die[dieNo].maxEraseCnt < WEAR_LEVELING_THRESHOLD)
+		return;
+
+	for(scanCnt = 0; scanCnt < WEAR_LEVELING_SCAN_BLOCKS; scanCnt++)
+	{
+		blockNo = virtualDieMapPtr->die[dieNo].wearScanBlock;
+		virtualDieMapPtr->die[dieNo].wearScanBlock = (blockNo + 1) % USER_BLOCKS_PER_DIE;
+
+		// only full blocks holding data, free, collected and bad blocks are skipped
+		if(virtualBlockMapPtr->block[dieNo][blockNo].bad || virtualBlockMapPtr->block[dieNo][blockNo].free || virtualBlockMapPtr->block[dieNo][blockNo].gcVictim)
+			continue;
+		if(virtualBlockMapPtr->block[dieNo][blockNo].currentPage != USER_PAGES_PER_BLOCK)
+			continue;
+		if(virtualBlockMapPtr->block[dieNo][blockNo].eraseCnt + WEAR_LEVELING_THRESHOLD > virtualDieMapPtr->die[dieNo].maxEraseCnt)
+			continue;
+
+		// blocks without invalid slices are on no victim list
+		if(virtualBlockMapPtr->block[dieNo][blockNo].invalidSliceCnt)
+			SelectiveGetFromGcVictimList(dieNo, blockNo);
+
+		StartGarbageCollectionOfBlock(dieNo, blockNo, 1);
+		wearLevelingCnt++;
+		return;
+	}
+}
+
+#ifdef WEAR_LEVELING_PROFILE
+// erase count distribution of every die and the copies wear leveling cost, endurance runs are judged from these lines
+void ReportWearLeveling()
+{
+	static XTime tReport = 0;
+	unsigned int dieNo, blockNo, eraseCnt, minEraseCnt, maxEraseCnt, bucketNo, blockCnt;
+	unsigned int eraseCntSum;
+	unsigned int bucketBlockCnt[WEAR_LEVELING_PROFILE_BUCKETS];
+	XTime tNow;
+
+	XTime_GetTime(&tNow);
+	if((tNow - tReport) < (COUNTS_PER_SECOND / 1000) * WEAR_LEVELING_PROFILE_PERIOD_MS)
+		return;
+	tReport = tNow;
+
+	for(dieNo = 0; dieNo < USER_DIES; dieNo++)
+	{
+		minEraseCnt = 0xffffffff;
+		maxEraseCnt = virtualDieMapPtr->die[dieNo].maxEraseCnt;
+		eraseCntSum = 0;
+		blockCnt = 0;
+		for(bucketNo = 0; bucketNo < WEAR_LEVELING_PROFILE_BUCKETS; bucketNo++)
+			bucketBlockCnt[bucketNo] = 0;
+
+		for(blockNo = 0; blockNo < USER_BLOCKS_PER_DIE; blockNo++)
+			if(!virtualBlockMapPtr->block[dieNo][blockNo].bad)
+			{
+				eraseCnt = virtualBlockMapPtr->block[dieNo][blockNo].eraseCnt;
+				if(eraseCnt < minEraseCnt)
+					minEraseCnt = eraseCnt;
+				eraseCntSum += eraseCnt;
+				blockCnt++;
+				bucketBlockCnt[eraseCnt * WEAR_LEVELING_PROFILE_BUCKETS / (maxEraseCnt + 1)]++;
+			}
+
+		if(blockCnt == 0)
+			continue;
+
+		xil_printf("WL: die %d erase count min %d avg %d max %d blocks per 1/%d of max:", dieNo, minEraseCnt, eraseCntSum / blockCnt, maxEraseCnt, WEAR_LEVELING_PROFILE_BUCKETS);
+		for(bucketNo = 0; bucketNo < WEAR_LEVELING_PROFILE_BUCKETS; bucketNo++)
+			xil_printf(" %d", bucketBlockCnt[bucketNo]);
+		xil_printf("\r\n");
+	}
+
+	xil_printf("WL: %d blocks migrated, %d pages copied of %d gc copies and %d host slices\r\n", wearLevelingCnt, wearLevelingCopyCnt, copyCnt, blockWriteSeq - copyCnt);
+}
+#endif
 
 void PutToGcVictimList(unsigned int dieNo, unsigned int blockNo, unsigned int invalidSliceCnt)
 {
@@ -146,38 +615,146 @@ void PutToGcVictimList(unsigned int dieNo, unsigned int blockNo, unsigned int in
 		virtualBlockMapPtr->block[dieNo][blockNo].nextBlock = BLOCK_NONE;
 		gcVictimMapPtr->gcVictimList[dieNo][invalidSliceCnt].headBlock = blockNo;
 		gcVictimMapPtr->gcVictimList[dieNo][invalidSliceCnt].tailBlock = blockNo;
+		gcVictimMapPtr->nonEmptyListBitmap[dieNo][invalidSliceCnt / 32] |= (1u << (invalidSliceCnt % 32));
 	}
 }
 
 unsigned int GetFromGcVictimList(unsigned int dieNo)
 {
 	unsigned int evictedBlockNo;
-	int invalidSliceCnt;
+#ifdef GC_VICTIM_PROFILE
+	static XTime selectTime = 0;
+	static XTime maxSelectTime = 0;
+	static unsigned int selectCnt = 0;
+	XTime tStart, tEnd;
+
+	XTime_GetTime(&tStart);
+#endif
+
+	// a fully invalid block costs no copy, every policy takes it first
+	if(gcVictimMapPtr->gcVictimList[dieNo][GC_VICTIM_LIST_FULLY_INVALID].headBlock != BLOCK_NONE)
+		evictedBlockNo = gcVictimMapPtr->gcVictimList[dieNo][GC_VICTIM_LIST_FULLY_INVALID].headBlock;
+	else
+	{
+#if (GC_VICTIM_POLICY == GC_VICTIM_POLICY_GREEDY)
+		evictedBlockNo = SelectGreedyVictim(dieNo);
+#elif (GC_VICTIM_POLICY == GC_VICTIM_POLICY_COST_BENEFIT)
+		evictedBlockNo = SelectCostBenefitVictim(dieNo);
+#elif (GC_VICTIM_POLICY == GC_VICTIM_POLICY_WINDOWED_GREEDY)
+		evictedBlockNo = SelectWindowedGreedyVictim(dieNo);
+#else
+#error "unsupported GC_VICTIM_POLICY"
+#endif
+	}
 
-	for(invalidSliceCnt = SLICES_PER_BLOCK; invalidSliceCnt > 0 ; invalidSliceCnt--)
+#ifdef GC_VICTIM_PROFILE
+	XTime_GetTime(&tEnd);
+	selectTime += tEnd - tStart;
+	if((tEnd - tStart) > maxSelectTime)
+		maxSelectTime = tEnd - tStart;
+
+	if(++selectCnt == GC_VICTIM_PROFILE_INTERVAL)
 	{
-		if(gcVictimMapPtr->gcVictimList[dieNo][invalidSliceCnt].headBlock != BLOCK_NONE)
+		xil_printf("GC victim selection: avg %d ticks, max %d ticks\r\n", (unsigned int)(selectTime / selectCnt), (unsigned int)maxSelectTime);
+		selectTime = 0;
+		maxSelectTime = 0;
+		selectCnt = 0;
+	}
+#endif
+
+	if(evictedBlockNo == BLOCK_NONE)
+	{
+		assert(!"[WARNING] There are no free blocks. Abort terminate this ssd. [WARNING]");
+		return BLOCK_FAIL;
+	}
+
+	SelectiveGetFromGcVictimList(dieNo, evictedBlockNo);
+
+	return evictedBlockNo;
+}
+
+// returns the highest non-empty victim list not above maxInvalidSliceCnt, 0 if there is none
+unsigned int FindGcVictimList(unsigned int dieNo, unsigned int maxInvalidSliceCnt)
+{
+	unsigned int wordNo, bitmap;
+
+	wordNo = maxInvalidSliceCnt / 32;
+	bitmap = gcVictimMapPtr->nonEmptyListBitmap[dieNo][wordNo] & (0xffffffff >> (31 - (maxInvalidSliceCnt % 32)));
+
+	while(!bitmap)
+	{
+		if(wordNo == 0)
+			return 0;
+
+		wordNo--;
+		bitmap = gcVictimMapPtr->nonEmptyListBitmap[dieNo][wordNo];
+	}
+
+	// highest non-empty list of the word
+	return wordNo * 32 + 31 - __builtin_clz(bitmap);
+}
+
+unsigned int SelectGreedyVictim(unsigned int dieNo)
+{
+	unsigned int invalidSliceCnt;
+
+	invalidSliceCnt = FindGcVictimList(dieNo, SLICES_PER_BLOCK);
+	if(invalidSliceCnt)
+		return gcVictimMapPtr->gcVictimList[dieNo][invalidSliceCnt].headBlock;
+
+	return BLOCK_NONE;
+}
+
+// only the head of each list is scored, it has waited longest at its invalid count
+unsigned int SelectCostBenefitVictim(unsigned int dieNo)
+{
+	unsigned int blockNo, victimBlockNo, age, invalidSliceCnt;
+	unsigned long long benefit, victimBenefit;
+
+	victimBlockNo = BLOCK_NONE;
+	victimBenefit = 0;
+
+	for(invalidSliceCnt = FindGcVictimList(dieNo, SLICES_PER_BLOCK - 1); invalidSliceCnt > 0 ; invalidSliceCnt = FindGcVictimList(dieNo, invalidSliceCnt - 1))
+	{
+		blockNo = gcVictimMapPtr->gcVictimList[dieNo][invalidSliceCnt].headBlock;
+
+		// benefit / cost = age * (1 - u) / 2u with u = valid / SLICES_PER_BLOCK
+		age = blockWriteSeq - virtualBlockMapPtr->block[dieNo][blockNo].lastWriteSeq + 1;
+		benefit = ((unsigned long long)age * invalidSliceCnt) / (2 * (SLICES_PER_BLOCK - invalidSliceCnt));
+
+		if((victimBlockNo == BLOCK_NONE) || (benefit > victimBenefit))
 		{
-			evictedBlockNo = gcVictimMapPtr->gcVictimList[dieNo][invalidSliceCnt].headBlock;
+			victimBlockNo = blockNo;
+			victimBenefit = benefit;
+		}
+	}
 
-			if(virtualBlockMapPtr->block[dieNo][evictedBlockNo].nextBlock != BLOCK_NONE)
-			{
-				virtualBlockMapPtr->block[dieNo][virtualBlockMapPtr->block[dieNo][evictedBlockNo].nextBlock].prevBlock = BLOCK_NONE;
-				gcVictimMapPtr->gcVictimList[dieNo][invalidSliceCnt].headBlock = virtualBlockMapPtr->block[dieNo][evictedBlockNo].nextBlock;
+	return victimBlockNo;
+}
 
-			}
-			else
-			{
-				gcVictimMapPtr->gcVictimList[dieNo][invalidSliceCnt].headBlock = BLOCK_NONE;
-				gcVictimMapPtr->gcVictimList[dieNo][invalidSliceCnt].tailBlock = BLOCK_NONE;
-			}
-			return evictedBlockNo;
+// greedy order, but the oldest block among the first GC_VICTIM_WINDOW candidates is taken so hot blocks can invalidate further
+unsigned int SelectWindowedGreedyVictim(unsigned int dieNo)
+{
+	unsigned int blockNo, victimBlockNo, candidateCnt, invalidSliceCnt;
+
+	victimBlockNo = BLOCK_NONE;
+	candidateCnt = 0;
+
+	for(invalidSliceCnt = FindGcVictimList(dieNo, SLICES_PER_BLOCK - 1); (invalidSliceCnt > 0) && (candidateCnt < GC_VICTIM_WINDOW); invalidSliceCnt = FindGcVictimList(dieNo, invalidSliceCnt - 1))
+	{
+		blockNo = gcVictimMapPtr->gcVictimList[dieNo][invalidSliceCnt].headBlock;
+
+		while((blockNo != BLOCK_NONE) && (candidateCnt < GC_VICTIM_WINDOW))
+		{
+			if((victimBlockNo == BLOCK_NONE) || ((blockWriteSeq - virtualBlockMapPtr->block[dieNo][blockNo].lastWriteSeq) > (blockWriteSeq - virtualBlockMapPtr->block[dieNo][victimBlockNo].lastWriteSeq)))
+				victimBlockNo = blockNo;
 
+			candidateCnt++;
+			blockNo = virtualBlockMapPtr->block[dieNo][blockNo].nextBlock;
 		}
 	}
 
-	assert(!"[WARNING] There are no free blocks. Abort terminate this ssd. [WARNING]");
-	return BLOCK_FAIL;
+	return victimBlockNo;
 }
 
 
@@ -208,6 +785,7 @@ void SelectiveGetFromGcVictimList(unsigned int dieNo, unsigned int blockNo)
 	{
 		gcVictimMapPtr->gcVictimList[dieNo][invalidSliceCnt].headBlock = BLOCK_NONE;
 		gcVictimMapPtr->gcVictimList[dieNo][invalidSliceCnt].tailBlock = BLOCK_NONE;
+		gcVictimMapPtr->nonEmptyListBitmap[dieNo][invalidSliceCnt / 32] &= ~(1u << (invalidSliceCnt % 32));
 	}
 }
 
@@ -54,19 +54,112 @@ typedef struct _GC_VICTIM_LIST_ENTRY {
 	unsigned int tailBlock : 16;
 } GC_VICTIM_LIST_ENTRY, *P_GC_VICTIM_LIST_ENTRY;
 
+// the list of the highest invalid count holds blocks without a valid slice, they are erased without a copy
+#define GC_VICTIM_LIST_FULLY_INVALID	SLICES_PER_BLOCK
+
+// one bit per victim list, set while the list is not empty
+#define GC_VICTIM_BITMAP_WORDS	((SLICES_PER_BLOCK + 1 + 31) / 32)
+
 typedef struct _GC_VICTIM_MAP {
 	GC_VICTIM_LIST_ENTRY gcVictimList[USER_DIES][SLICES_PER_BLOCK + 1];
+	unsigned int nonEmptyListBitmap[USER_DIES][GC_VICTIM_BITMAP_WORDS];
 } GC_VICTIM_MAP, *P_GC_VICTIM_MAP;
 
+#define GC_DIE_STATE_IDLE	0
+#define GC_DIE_STATE_COPY	1
+
+// valid pages copied per die in one ftl pass, bounds how long a pass spends on gc before host work
+#define GC_PAGES_PER_ROUND	TEMPORARY_DATA_BUFFER_ENTRY_COUNT_PER_DIE
+
+typedef struct _GC_DIE_STATE_ENTRY {
+	unsigned int victimBlock : 16;
+	unsigned int nextPage : 14;
+	unsigned int wearLeveling : 1;		// the victim is a cold block migrated by static wear leveling
+	unsigned int state : 1;
+} GC_DIE_STATE_ENTRY, *P_GC_DIE_STATE_ENTRY;
+
+typedef struct _GC_DIE_STATE_TABLE {
+	GC_DIE_STATE_ENTRY gcDieState[USER_DIES];
+} GC_DIE_STATE_TABLE, *P_GC_DIE_STATE_TABLE;
+
+// a die below the soft watermark is collected in the background while it is idle, the reserve count still triggers foreground gc
+#define GC_SOFT_FREE_BLOCK_WATERMARK	(RESERVED_FREE_BLOCK_COUNT + 8)
+// background gc leaves blocks with fewer invalid slices to the foreground, they cost more copies than they free
+#define GC_BACKGROUND_MIN_INVALID_SLICES	(SLICES_PER_BLOCK / 4)
+// collected blocks are erased while their die is idle, or at once while the die has fewer pre-erased free blocks
+#define GC_PRE_ERASED_BLOCK_TARGET	(RESERVED_FREE_BLOCK_COUNT + 4)		//user configurable factor
+// free blocks of a die counting the collected ones waiting for their erase
+#define GC_AVAILABLE_BLOCK_COUNT(dieNo)	(virtualDieMapPtr->die[(dieNo)].freeBlockCnt + virtualDieMapPtr->die[(dieNo)].eraseWaitBlockCnt)
+// a die this close to the reserve starts collecting even while the host is busy, so the allocation path rarely collects synchronously
+#define GC_URGENT_FREE_BLOCK_WATERMARK	(RESERVED_FREE_BLOCK_COUNT + 2)
+// global gc bandwidth, the pages copied per ftl pass over all dies and the dies collecting at once
+#define GC_MAX_PAGES_PER_PASS	(GC_PAGES_PER_ROUND * USER_DIES)	//user configurable factor
+#define GC_MAX_ACTIVE_DIES		(USER_DIES)							//user configurable factor
+// a die whose queue still holds this many requests gets no new copies in the pass, its queue is kept short for host requests
+#define GC_DIE_QUEUE_DEPTH		(GC_PAGES_PER_ROUND * 2)
+
+// victim selection policies
+#define GC_VICTIM_POLICY_GREEDY			0	// most invalid slices
+#define GC_VICTIM_POLICY_COST_BENEFIT	1	// age * (1 - u) / 2u over the oldest block of each invalid count
+#define GC_VICTIM_POLICY_WINDOWED_GREEDY	2	// oldest of the GC_VICTIM_WINDOW greediest blocks
+
+#define GC_VICTIM_POLICY	GC_VICTIM_POLICY_GREEDY		//user configurable factor
+#define GC_VICTIM_WINDOW	16
+
+// static wear leveling, a full block this many erases behind the most worn block of its die is migrated while the die is idle
+#define WEAR_LEVELING_THRESHOLD		64		//user configurable factor
+#define WEAR_LEVELING_SCAN_BLOCKS	16		// blocks looked at per call
+
+// #define WEAR_LEVELING_PROFILE
+
+// gc pacing, a host written slice earns the copies that keep gc level with it, u / (1 - u) pages for victims of valid ratio u
+#define GC_PACER_CREDIT_UNIT			16		// credits per copied page, fixed point of the earning rate
+#define GC_PACER_MAX_CREDIT				(GC_PAGES_PER_ROUND * USER_DIES * 8 * GC_PACER_CREDIT_UNIT)	//user configurable factor, host commands are held while gc owes this much
+#define GC_PACER_MIN_PAGES_PER_ROUND	1		//user configurable factor, a collection still advances while the host writes little
+
+typedef struct _GC_PACER {
+	unsigned int credit;					// copies owed to host writes in GC_PACER_CREDIT_UNIT
+	unsigned int victimValidSliceCnt;		// moving average over the recent victims
+	unsigned int activeDieCnt;				// dies with a collection in progress, credit is only earned while there is one
+} GC_PACER, *P_GC_PACER;
+
+// #define GC_PACER_PROFILE
+
+// #define GC_COPY_PROFILE
+// #define GC_VICTIM_PROFILE
+
 void InitGcVictimMap();
 void GarbageCollection(unsigned int dieNo);
+void StartGarbageCollection(unsigned int dieNo);
+void StartGarbageCollectionOfBlock(unsigned int dieNo, unsigned int victimBlockNo, unsigned int wearLeveling);
+void GarbageCollectionStep(unsigned int dieNo, unsigned int pageBudget);
+void IncrementalGarbageCollection(unsigned int hostIdle);
+void EarnGcCredit();
+void SpendGcCredit(unsigned int copiedPageCnt);
+unsigned int CheckGcPacerAdmit();
+unsigned int FindDieForGcCopy(unsigned int victimDieNo);
+void EraseAheadOfDemand();
+unsigned int CheckGcVictim(unsigned int dieNo, unsigned int minInvalidSliceCnt);
+void BackgroundGarbageCollection();
+void StaticWearLeveling();
+#ifdef WEAR_LEVELING_PROFILE
+void ReportWearLeveling();
+#endif
 
 void PutToGcVictimList(unsigned int dieNo, unsigned int blockNo, unsigned int invalidSliceCnt);
 unsigned int GetFromGcVictimList(unsigned int dieNo);
+unsigned int FindGcVictimList(unsigned int dieNo, unsigned int maxInvalidSliceCnt);
+unsigned int SelectGreedyVictim(unsigned int dieNo);
+unsigned int SelectCostBenefitVictim(unsigned int dieNo);
+unsigned int SelectWindowedGreedyVictim(unsigned int dieNo);
 void SelectiveGetFromGcVictimList(unsigned int dieNo, unsigned int blockNo);
 
 extern P_GC_VICTIM_MAP gcVictimMapPtr;
+extern GC_DIE_STATE_TABLE gcDieStateTable;
+extern GC_PACER gcPacer;
 extern unsigned int gcTriggered;
 extern unsigned int copyCnt;
+extern unsigned int wearLevelingCnt;
+extern unsigned int wearLevelingCopyCnt;
 
 #endif /* GARBAGE_COLLECTION_H_ */
@@ -452,6 +452,82 @@ void set_auto_rx_dma(unsigned int cmdSlotTag, unsigned int cmd4KBOffset, unsigne
 	g_hostDmaStatus.autoDmaRxCnt++;
 }
 
+//each 4KB block still takes its three descriptor writes, the run only shares one fifo space wait and one tail update
+void set_auto_tx_dma_blocks(unsigned int cmdSlotTag, unsigned int cmd4KBOffset, unsigned int devAddr, unsigned int numOfBlock, unsigned int autoCompletion)
+{
+	HOST_DMA_CMD_FIFO_REG hostDmaReg;
+	unsigned char tempTail;
+	unsigned int blockNo;
+
+	ASSERT((cmd4KBOffset + numOfBlock <= 256) && (numOfBlock < 256));
+
+	//wait once until the whole run fits in the fifo
+	g_hostDmaStatus.fifoHead.dword = IO_READ32(HOST_DMA_FIFO_CNT_REG_ADDR);
+	while((unsigned char)(g_hostDmaStatus.fifoTail.autoDmaTx - g_hostDmaStatus.fifoHead.autoDmaTx) + numOfBlock > 255)
+		g_hostDmaStatus.fifoHead.dword = IO_READ32(HOST_DMA_FIFO_CNT_REG_ADDR);
+
+	hostDmaReg.dword[3] = 0;
+	hostDmaReg.dmaType = HOST_DMA_AUTO_TYPE;
+	hostDmaReg.dmaDirection = HOST_DMA_TX_DIRECTION;
+	hostDmaReg.cmdSlotTag = cmdSlotTag;
+	hostDmaReg.autoCompletion = autoCompletion;
+
+	for(blockNo = 0; blockNo < numOfBlock; blockNo++)
+	{
+		hostDmaReg.devAddr = devAddr + blockNo * HOST_DMA_AUTO_BLOCK_SIZE;
+		hostDmaReg.cmd4KBOffset = cmd4KBOffset + blockNo;
+
+		IO_WRITE32(HOST_DMA_CMD_FIFO_REG_ADDR, hostDmaReg.dword[0]);
+		IO_WRITE32((HOST_DMA_CMD_FIFO_REG_ADDR + 12), hostDmaReg.dword[3]);
+		IO_WRITE32((HOST_DMA_CMD_FIFO_REG_ADDR + 16), hostDmaReg.dword[4]);//slot_modified
+	}
+
+	tempTail = g_hostDmaStatus.fifoTail.autoDmaTx;
+	g_hostDmaStatus.fifoTail.autoDmaTx += numOfBlock;
+	if(tempTail > g_hostDmaStatus.fifoTail.autoDmaTx)
+		g_hostDmaAssistStatus.autoDmaTxOverFlowCnt++;
+
+	g_hostDmaStatus.autoDmaTxCnt += numOfBlock;
+}
+
+//same as set_auto_tx_dma_blocks for host to device transfers
+void set_auto_rx_dma_blocks(unsigned int cmdSlotTag, unsigned int cmd4KBOffset, unsigned int devAddr, unsigned int numOfBlock, unsigned int autoCompletion)
+{
+	HOST_DMA_CMD_FIFO_REG hostDmaReg;
+	unsigned char tempTail;
+	unsigned int blockNo;
+
+	ASSERT((cmd4KBOffset + numOfBlock <= 256) && (numOfBlock < 256));
+
+	//wait once until the whole run fits in the fifo
+	g_hostDmaStatus.fifoHead.dword = IO_READ32(HOST_DMA_FIFO_CNT_REG_ADDR);
+	while((unsigned char)(g_hostDmaStatus.fifoTail.autoDmaRx - g_hostDmaStatus.fifoHead.autoDmaRx) + numOfBlock > 255)
+		g_hostDmaStatus.fifoHead.dword = IO_READ32(HOST_DMA_FIFO_CNT_REG_ADDR);
+
+	hostDmaReg.dword[3] = 0;
+	hostDmaReg.dmaType = HOST_DMA_AUTO_TYPE;
+	hostDmaReg.dmaDirection = HOST_DMA_RX_DIRECTION;
+	hostDmaReg.cmdSlotTag = cmdSlotTag;
+	hostDmaReg.autoCompletion = autoCompletion;
+
+	for(blockNo = 0; blockNo < numOfBlock; blockNo++)
+	{
+		hostDmaReg.devAddr = devAddr + blockNo * HOST_DMA_AUTO_BLOCK_SIZE;
+		hostDmaReg.cmd4KBOffset = cmd4KBOffset + blockNo;
+
+		IO_WRITE32(HOST_DMA_CMD_FIFO_REG_ADDR, hostDmaReg.dword[0]);
+		IO_WRITE32((HOST_DMA_CMD_FIFO_REG_ADDR + 12), hostDmaReg.dword[3]);
+		IO_WRITE32((HOST_DMA_CMD_FIFO_REG_ADDR + 16), hostDmaReg.dword[4]);//slot_modified
+	}
+
+	tempTail = g_hostDmaStatus.fifoTail.autoDmaRx;
+	g_hostDmaStatus.fifoTail.autoDmaRx += numOfBlock;
+	if(tempTail > g_hostDmaStatus.fifoTail.autoDmaRx)
+		g_hostDmaAssistStatus.autoDmaRxOverFlowCnt++;
+
+	g_hostDmaStatus.autoDmaRxCnt += numOfBlock;
+}
+
 void check_direct_tx_dma_done()
 {
 	while(g_hostDmaStatus.fifoHead.directDmaTx != g_hostDmaStatus.fifoTail.directDmaTx)
@@ -484,12 +560,23 @@ void check_auto_rx_dma_done()
 	}
 }
 
+void update_auto_dma_fifo_head()
+{
+	g_hostDmaStatus.fifoHead.dword = IO_READ32(HOST_DMA_FIFO_CNT_REG_ADDR);
+}
+
 unsigned int check_auto_tx_dma_partial_done(unsigned int tailIndex, unsigned int tailAssistIndex)
 {
 	//xil_printf("check_auto_tx_dma_partial_done \r\n");
 
 	g_hostDmaStatus.fifoHead.dword = IO_READ32(HOST_DMA_FIFO_CNT_REG_ADDR);
 
+	return check_auto_tx_dma_batch_done(tailIndex, tailAssistIndex);
+}
+
+//evaluates against the fifo head captured by the last update_auto_dma_fifo_head()
+unsigned int check_auto_tx_dma_batch_done(unsigned int tailIndex, unsigned int tailAssistIndex)
+{
 	if(g_hostDmaStatus.fifoHead.autoDmaTx == g_hostDmaStatus.fifoTail.autoDmaTx)
 		return 1;
 
@@ -533,6 +620,12 @@ unsigned int check_auto_rx_dma_partial_done(unsigned int tailIndex, unsigned int
 
 	g_hostDmaStatus.fifoHead.dword = IO_READ32(HOST_DMA_FIFO_CNT_REG_ADDR);
 
+	return check_auto_rx_dma_batch_done(tailIndex, tailAssistIndex);
+}
+
+//evaluates against the fifo head captured by the last update_auto_dma_fifo_head()
+unsigned int check_auto_rx_dma_batch_done(unsigned int tailIndex, unsigned int tailAssistIndex)
+{
 	if(g_hostDmaStatus.fifoHead.autoDmaRx == g_hostDmaStatus.fifoTail.autoDmaRx)
 		return 1;
 
@@ -46,6 +46,7 @@
 // * v1.1.0
 //   - new DMA status type is added (HOST_DMA_ASSIST_STATUS)
 //	 - DMA partial done check functions are added
+//	 - multi-block auto DMA issue and batched done check functions are added
 //
 // * v1.0.0
 //   - First draft
@@ -85,6 +86,8 @@
 #define HOST_DMA_TX_DIRECTION				(1)
 #define HOST_DMA_RX_DIRECTION				(0)
 
+#define HOST_DMA_AUTO_BLOCK_SIZE			(0x1000)
+
 #define ONLY_CPL_TYPE						(0)
 #define AUTO_CPL_TYPE						(1)
 #define CMD_SLOT_RELEASE_TYPE				(2)
@@ -358,6 +361,10 @@ void set_auto_tx_dma(unsigned int cmdSlotTag, unsigned int cmd4KBOffset, unsigne
 
 void set_auto_rx_dma(unsigned int cmdSlotTag, unsigned int cmd4KBOffset, unsigned int devAddr, unsigned int autoCompletion);
 
+void set_auto_tx_dma_blocks(unsigned int cmdSlotTag, unsigned int cmd4KBOffset, unsigned int devAddr, unsigned int numOfBlock, unsigned int autoCompletion);
+
+void set_auto_rx_dma_blocks(unsigned int cmdSlotTag, unsigned int cmd4KBOffset, unsigned int devAddr, unsigned int numOfBlock, unsigned int autoCompletion);
+
 void set_link_width(unsigned int linkNum);
 
 void pcie_async_reset(unsigned int rstCnt);
@@ -374,6 +381,12 @@ unsigned int check_auto_tx_dma_partial_done(unsigned int tailIndex, unsigned int
 
 unsigned int check_auto_rx_dma_partial_done(unsigned int tailIndex, unsigned int tailAssistIndex);
 
+void update_auto_dma_fifo_head();
+
+unsigned int check_auto_tx_dma_batch_done(unsigned int tailIndex, unsigned int tailAssistIndex);
+
+unsigned int check_auto_rx_dma_batch_done(unsigned int tailIndex, unsigned int tailAssistIndex);
+
 extern HOST_DMA_STATUS g_hostDmaStatus;
 extern HOST_DMA_ASSIST_STATUS g_hostDmaAssistStatus;
 
@@ -199,6 +199,12 @@
 #define NVME_TASK_SHUTDOWN 0x3
 #define NVME_TASK_WAIT_RESET 0x4
 #define NVME_TASK_RESET 0x5
+
+/* Create I/O Submission Queue - Queue Priority */
+#define IO_SQ_PRIORITY_URGENT 0x0
+#define IO_SQ_PRIORITY_HIGH 0x1
+#define IO_SQ_PRIORITY_MEDIUM 0x2
+#define IO_SQ_PRIORITY_LOW 0x3
 #pragma pack(push, 1)
 
 typedef struct _NVME_COMMAND
@@ -336,6 +342,22 @@ typedef struct _ADMIN_SET_FEATURES_NUMBER_OF_QUEUES_COMPLETE
 	};
 } ADMIN_SET_FEATURES_NUMBER_OF_QUEUES_COMPLETE;
 
+typedef struct _ADMIN_SET_FEATURES_ARBITRATION_DW11
+{
+	union
+	{
+		unsigned int dword;
+		struct
+		{
+			unsigned char AB : 3;
+			unsigned char reserved0 : 5;
+			unsigned char LPW; // zero-based value
+			unsigned char MPW; // zero-based value
+			unsigned char HPW; // zero-based value
+		};
+	};
+} ADMIN_SET_FEATURES_ARBITRATION_DW11;
+
 /* Get Features Command */
 typedef struct _ADMIN_GET_FEATURES_DW10
 {
@@ -861,6 +883,8 @@ typedef struct _NVME_IO_SQ_STATUS
 	unsigned short qSzie;
 	unsigned int pcieBaseAddrL;
 	unsigned int pcieBaseAddrH;
+	unsigned char priority;
+	unsigned char reserved0[3];
 } NVME_IO_SQ_STATUS;
 
 typedef struct _NVME_IO_CQ_STATUS
@@ -878,6 +902,7 @@ typedef struct _NVME_STATUS
 {
 	unsigned int status;
 	unsigned int cacheEn;
+	unsigned int arbitration;
 	NVME_ADMIN_QUEUE_STATUS adminQueueInfo;
 	unsigned short numOfIOSubmissionQueuesAllocated; // non zero-based value
 	unsigned short numOfIOCompletionQueuesAllocated; // non zero-based value
@@ -121,6 +121,8 @@ void handle_set_features(NVME_ADMIN_COMMAND *nvmeAdminCmd, NVME_COMPLETION *nvme
 		}
 		case ARBITRATION:
 		{
+			xil_printf("Set Arbitration: 0x%X\r\n", nvmeAdminCmd->dword11);
+			g_nvmeTask.arbitration = nvmeAdminCmd->dword11;
 			nvmeCPL->dword[0] = 0x0;
 			nvmeCPL->specific = 0x0;
 			break;
@@ -193,6 +195,12 @@ void handle_get_features(NVME_ADMIN_COMMAND *nvmeAdminCmd, NVME_COMPLETION *nvme
 			nvmeCPL->specific = 0x0;
 			break;
 		}
+		case ARBITRATION:
+		{
+			nvmeCPL->dword[0] = 0x0;
+			nvmeCPL->specific = g_nvmeTask.arbitration;
+			break;
+		}
 		case TEMPERATURE_THRESHOLD:
 		{
 			nvmeCPL->dword[0] = 0x0;
@@ -263,6 +271,7 @@ void handle_create_io_sq(NVME_ADMIN_COMMAND *nvmeAdminCmd, NVME_COMPLETION *nvme
 	ioSqStatus->valid = 1;
 	ioSqStatus->qSzie = sqInfo10.QSIZE;
 	ioSqStatus->cqVector = sqInfo11.CQID;
+	ioSqStatus->priority = sqInfo11.QPRIO;
 	ioSqStatus->pcieBaseAddrL = nvmeAdminCmd->PRP1[0];
 	ioSqStatus->pcieBaseAddrH = nvmeAdminCmd->PRP1[1];
 
@@ -289,6 +298,7 @@ void handle_delete_io_sq(NVME_ADMIN_COMMAND *nvmeAdminCmd, NVME_COMPLETION *nvme
 	ioSqStatus->valid = 0;
 	ioSqStatus->cqVector = 0;
 	ioSqStatus->qSzie = 0;
+	ioSqStatus->priority = 0;
 	ioSqStatus->pcieBaseAddrL = 0;
 	ioSqStatus->pcieBaseAddrH = 0;
 
@@ -50,6 +50,7 @@
 //////////////////////////////////////////////////////////////////////////////////
 
 #include "xil_printf.h"
+#include "xpseudo_asm.h"
 #include "debug.h"
 #include "io_access.h"
 
@@ -58,9 +59,106 @@
 #include "nvme_io_cmd.h"
 
 #include "../ftl_config.h"
+#include "../request_format.h"
 #include "../request_transform.h"
 
-void handle_nvme_io_read(unsigned int cmdSlotTag, NVME_IO_COMMAND *nvmeIOCmd)
+// a host command slot is queued at most once, so the ring never holds more than all slots
+#define NVME_IO_CMD_RING_ENTRY_COUNT	((1 << P_SLOT_TAG_WIDTH) + 1)
+
+typedef struct _NVME_IO_CMD_RING_ENTRY
+{
+	unsigned int cmdSlotTag : 16;
+	unsigned int cmdCode : 8;
+	unsigned int ioClass : 2;
+	unsigned int reserved0 : 6;
+	unsigned int startLba;
+	unsigned int nlb;
+} NVME_IO_CMD_RING_ENTRY;
+
+// single-producer (host interface) / single-consumer (ftl) ring
+typedef struct _NVME_IO_CMD_RING
+{
+	volatile unsigned int putIndex;
+	unsigned char reserved0[BYTES_PER_CACHE_LINE - sizeof(unsigned int)];
+	volatile unsigned int getIndex;
+	unsigned char reserved1[BYTES_PER_CACHE_LINE - sizeof(unsigned int)];
+	NVME_IO_CMD_RING_ENTRY entry[NVME_IO_CMD_RING_ENTRY_COUNT];
+} __attribute__((aligned(BYTES_PER_CACHE_LINE))) NVME_IO_CMD_RING;
+
+NVME_IO_CMD_RING g_nvmeIoCmdRing;
+
+extern NVME_CONTEXT g_nvmeTask;
+
+void init_nvme_io_cmd_ring()
+{
+	g_nvmeIoCmdRing.putIndex = 0;
+	g_nvmeIoCmdRing.getIndex = 0;
+}
+
+void put_nvme_io_cmd(unsigned int cmdSlotTag, unsigned int startLba, unsigned int nlb, unsigned int cmdCode, unsigned int ioClass)
+{
+	unsigned int putIndex, nextPutIndex;
+
+	putIndex = g_nvmeIoCmdRing.putIndex;
+	nextPutIndex = putIndex + 1;
+	if (nextPutIndex == NVME_IO_CMD_RING_ENTRY_COUNT)
+		nextPutIndex = 0;
+
+	ASSERT(nextPutIndex != g_nvmeIoCmdRing.getIndex);
+
+	g_nvmeIoCmdRing.entry[putIndex].cmdSlotTag = cmdSlotTag;
+	g_nvmeIoCmdRing.entry[putIndex].cmdCode = cmdCode;
+	g_nvmeIoCmdRing.entry[putIndex].ioClass = ioClass;
+	g_nvmeIoCmdRing.entry[putIndex].startLba = startLba;
+	g_nvmeIoCmdRing.entry[putIndex].nlb = nlb;
+
+	dmb();
+	g_nvmeIoCmdRing.putIndex = nextPutIndex;
+}
+
+// called by the ftl, reports the code of the oldest queued io command without taking it
+unsigned int peek_nvme_io_cmd(unsigned int *cmdCode)
+{
+	unsigned int getIndex;
+
+	getIndex = g_nvmeIoCmdRing.getIndex;
+	if (getIndex == g_nvmeIoCmdRing.putIndex)
+		return 0;
+
+	dmb();
+	*cmdCode = g_nvmeIoCmdRing.entry[getIndex].cmdCode;
+
+	return 1;
+}
+
+// called by the ftl, splits one queued io command into slice requests
+unsigned int fetch_nvme_io_cmd()
+{
+	unsigned int getIndex, cmdSlotTag, startLba, nlb, cmdCode, ioClass;
+
+	getIndex = g_nvmeIoCmdRing.getIndex;
+	if (getIndex == g_nvmeIoCmdRing.putIndex)
+		return 0;
+
+	dmb();
+	cmdSlotTag = g_nvmeIoCmdRing.entry[getIndex].cmdSlotTag;
+	cmdCode = g_nvmeIoCmdRing.entry[getIndex].cmdCode;
+	ioClass = g_nvmeIoCmdRing.entry[getIndex].ioClass;
+	startLba = g_nvmeIoCmdRing.entry[getIndex].startLba;
+	nlb = g_nvmeIoCmdRing.entry[getIndex].nlb;
+
+	dmb();
+	getIndex++;
+	if (getIndex == NVME_IO_CMD_RING_ENTRY_COUNT)
+		getIndex = 0;
+	g_nvmeIoCmdRing.getIndex = getIndex;
+
+	ReqTransNvmeToSlice(cmdSlotTag, startLba, nlb, cmdCode, ioClass);
+
+	return 1;
+}
+
+void handle_nvme_io_read(unsigned int cmdSlotTag, NVME_IO_COMMAND *nvmeIOCmd, unsigned int ioClass)
 {
 	IO_READ_COMMAND_DW12 readInfo12;
 	// IO_READ_COMMAND_DW13 readInfo13;
@@ -81,10 +179,10 @@ void handle_nvme_io_read(unsigned int cmdSlotTag, NVME_IO_COMMAND *nvmeIOCmd)
 	ASSERT((nvmeIOCmd->PRP1[0] & 0x3) == 0 && (nvmeIOCmd->PRP2[0] & 0x3) == 0); // error
 	ASSERT(nvmeIOCmd->PRP1[1] < 0x10000 && nvmeIOCmd->PRP2[1] < 0x10000);
 
-	ReqTransNvmeToSlice(cmdSlotTag, startLba[0], nlb, IO_NVM_READ);
+	put_nvme_io_cmd(cmdSlotTag, startLba[0], nlb, IO_NVM_READ, ioClass);
 }
 
-void handle_nvme_io_write(unsigned int cmdSlotTag, NVME_IO_COMMAND *nvmeIOCmd)
+void handle_nvme_io_write(unsigned int cmdSlotTag, NVME_IO_COMMAND *nvmeIOCmd, unsigned int ioClass)
 {
 	IO_READ_COMMAND_DW12 writeInfo12;
 	// IO_READ_COMMAND_DW13 writeInfo13;
@@ -108,10 +206,10 @@ void handle_nvme_io_write(unsigned int cmdSlotTag, NVME_IO_COMMAND *nvmeIOCmd)
 	ASSERT((nvmeIOCmd->PRP1[0] & 0xF) == 0 && (nvmeIOCmd->PRP2[0] & 0xF) == 0);
 	ASSERT(nvmeIOCmd->PRP1[1] < 0x10000 && nvmeIOCmd->PRP2[1] < 0x10000);
 
-	ReqTransNvmeToSlice(cmdSlotTag, startLba[0], nlb, IO_NVM_WRITE);
+	put_nvme_io_cmd(cmdSlotTag, startLba[0], nlb, IO_NVM_WRITE, ioClass);
 }
 
-void handle_nvme_io_pwrite(unsigned int cmdSlotTag, NVME_IO_COMMAND *nvmeIOCmd)
+void handle_nvme_io_pwrite(unsigned int cmdSlotTag, NVME_IO_COMMAND *nvmeIOCmd, unsigned int ioClass)
 {
 	IO_READ_COMMAND_DW12 writeInfo12;
 	// IO_READ_COMMAND_DW13 writeInfo13;
@@ -135,18 +233,34 @@ void handle_nvme_io_pwrite(unsigned int cmdSlotTag, NVME_IO_COMMAND *nvmeIOCmd)
 	ASSERT((nvmeIOCmd->PRP1[0] & 0xF) == 0 && (nvmeIOCmd->PRP2[0] & 0xF) == 0);
 	ASSERT(nvmeIOCmd->PRP1[1] < 0x10000 && nvmeIOCmd->PRP2[1] < 0x10000);
 
-	ReqTransNvmeToSlice(cmdSlotTag, startLba[0], nlb, IO_NVM_PWRITE);
+	put_nvme_io_cmd(cmdSlotTag, startLba[0], nlb, IO_NVM_PWRITE, ioClass);
 }
 
 void handle_nvme_io_cmd(NVME_COMMAND *nvmeCmd)
 {
 	NVME_IO_COMMAND *nvmeIOCmd;
 	NVME_COMPLETION nvmeCPL;
-	unsigned int opc;
+	unsigned int opc, ioClass;
 
 	nvmeIOCmd = (NVME_IO_COMMAND *)nvmeCmd->cmdDword;
 
 	opc = (unsigned int)nvmeIOCmd->OPC;
+	// the priority given to the submission queue at creation time
+	switch (g_nvmeTask.ioSqInfo[nvmeCmd->qID - 1].priority)
+	{
+	case IO_SQ_PRIORITY_URGENT:
+		ioClass = REQ_OPT_IO_CLASS_URGENT;
+		break;
+	case IO_SQ_PRIORITY_HIGH:
+		ioClass = REQ_OPT_IO_CLASS_HIGH;
+		break;
+	case IO_SQ_PRIORITY_MEDIUM:
+		ioClass = REQ_OPT_IO_CLASS_MEDIUM;
+		break;
+	default:
+		ioClass = REQ_OPT_IO_CLASS_LOW;
+		break;
+	}
 
 	switch (opc)
 	{
@@ -161,13 +275,13 @@ void handle_nvme_io_cmd(NVME_COMMAND *nvmeCmd)
 	case IO_NVM_WRITE:
 	{
 		PRINT("IO Write Command\r\n");
-		handle_nvme_io_write(nvmeCmd->cmdSlotTag, nvmeIOCmd);
+		handle_nvme_io_write(nvmeCmd->cmdSlotTag, nvmeIOCmd, ioClass);
 		break;
 	}
 	case IO_NVM_READ:
 	{
 		PRINT("IO Read Command\r\n");
-		handle_nvme_io_read(nvmeCmd->cmdSlotTag, nvmeIOCmd);
+		handle_nvme_io_read(nvmeCmd->cmdSlotTag, nvmeIOCmd, ioClass);
 		break;
 	}
 	case IO_NVM_WRITE_ZEROS:
@@ -181,7 +295,7 @@ void handle_nvme_io_cmd(NVME_COMMAND *nvmeCmd)
 	case IO_NVM_PWRITE:
 	{
 		PRINT("IO P-Write Command\r\n");
-		handle_nvme_io_write(nvmeCmd->cmdSlotTag, nvmeIOCmd);
+		handle_nvme_io_write(nvmeCmd->cmdSlotTag, nvmeIOCmd, ioClass);
 		break;
 	}
 
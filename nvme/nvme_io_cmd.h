@@ -49,4 +49,9 @@
 
 void handle_nvme_io_cmd(NVME_COMMAND *nvmeCmd);
 
+void init_nvme_io_cmd_ring();
+void put_nvme_io_cmd(unsigned int cmdSlotTag, unsigned int startLba, unsigned int nlb, unsigned int cmdCode, unsigned int ioClass);
+unsigned int peek_nvme_io_cmd(unsigned int *cmdCode);
+unsigned int fetch_nvme_io_cmd();
+
 #endif	//__NVME_IO_CMD_H_
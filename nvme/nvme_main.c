@@ -71,6 +71,17 @@
 
 volatile NVME_CONTEXT g_nvmeTask;
 
+// commands taken from the host command fifo and from the io command ring per pass
+#define NVME_CMD_FETCH_BATCH	8
+#define FTL_IO_CMD_BATCH		8
+
+// low level scheduler passes per ftl pass, one more pass per LLR_REQS_PER_PASS outstanding requests
+#define LLR_PASS_MIN			1
+#define LLR_PASS_MAX			8
+#define LLR_REQS_PER_PASS		(USER_DIES)
+
+// #define NVME_IOPS_REPORT
+
 // #define NAND_STANDALONE_TEST
 
 #ifdef NAND_STANDALONE_TEST
@@ -85,22 +96,127 @@ typedef enum
 static nand_op_type nand_op;
 #endif
 
+void ftl_task()
+{
+	unsigned int ioCmdCnt, outstandingReqCnt, llrPassCnt, hostIdle, cmdPending, cmdCode;
+#ifdef NVME_IOPS_REPORT
+	static unsigned int reportedIoCmdCnt = 0;
+	static XTime tReport = 0;
+	XTime tNow;
+#endif
+
+	// backpressure, host commands stay in the ring while the request pool is low so gc never spins for a free request
+	// and writes stay there while gc lags behind them, reads are not held by the pacer
+	ioCmdCnt = 0;
+	while ((cmdPending = peek_nvme_io_cmd(&cmdCode)) && (ioCmdCnt < FTL_IO_CMD_BATCH) && (freeReqQ.reqCnt >= FREE_REQ_HOST_FETCH_WATERMARK))
+	{
+		if (((cmdCode == IO_NVM_WRITE) || (cmdCode == IO_NVM_PWRITE)) && !CheckGcPacerAdmit())
+			break;
+
+		fetch_nvme_io_cmd();
+		ioCmdCnt++;
+	}
+
+	// slices left over by the last pass are still waiting for their class turn
+	ReqTransSliceToLowLevel();
+	// commands held in the ring keep the host busy as well
+	hostIdle = (ioCmdCnt == 0) && !cmdPending && (GetSliceReqCnt() == 0);
+
+	IncrementalGarbageCollection(hostIdle);
+#ifdef NVME_IOPS_REPORT
+	reportedIoCmdCnt += ioCmdCnt;
+#endif
+
+	// no new host command in this pass, use the idle dies to collect garbage, clean and prefetch the buffer ahead of demand
+	if (hostIdle && (notCompletedNandReqCnt + blockedReqCnt < DATA_BUF_DESTAGE_NAND_REQ_LIMIT))
+	{
+		BackgroundGarbageCollection();
+		StaticWearLeveling();
+		DestageDataBuf();
+		ReadAheadDataBuf();
+	}
+
+	outstandingReqCnt = nvmeDmaReqQ[NVME_DMA_REQ_Q_RX].reqCnt + nvmeDmaReqQ[NVME_DMA_REQ_Q_TX].reqCnt + notCompletedNandReqCnt + blockedReqCnt;
+	if (outstandingReqCnt)
+	{
+#if 0
+		static unsigned int saved_notCompletedNandReqCnt, saved_blockedReqCnt;
+		static unsigned int check_cnt;
+#endif
+		llrPassCnt = LLR_PASS_MIN + outstandingReqCnt / LLR_REQS_PER_PASS;
+		if (llrPassCnt > LLR_PASS_MAX)
+			llrPassCnt = LLR_PASS_MAX;
+
+		while (llrPassCnt--)
+		{
+			CheckDoneNvmeDmaReq();
+			SchedulingNandReq();
+		}
+
+#if 0
+#if 0
+		if(notCompletedNandReqCnt || blockedReqCnt)
+		{
+			xil_printf("notCompletedNandReqCnt=%d,blockedReqCnt=%d\r\n", notCompletedNandReqCnt, blockedReqCnt);
+		}
+#else
+		if(saved_notCompletedNandReqCnt == notCompletedNandReqCnt && saved_blockedReqCnt == blockedReqCnt)
+		{
+			check_cnt++;
+			if(check_cnt > 10000)
+			{
+				xil_printf("notCompletedNandReqCnt=%d,blockedReqCnt=%d\r\n", notCompletedNandReqCnt, blockedReqCnt);
+			}
+		}
+		else
+		{
+			check_cnt = 0;
+		}
+		saved_notCompletedNandReqCnt = notCompletedNandReqCnt;
+		saved_blockedReqCnt = blockedReqCnt;
+#endif
+#endif
+	}
+
+#ifdef NVME_IOPS_REPORT
+	XTime_GetTime(&tNow);
+	if (tNow - tReport >= COUNTS_PER_SECOND)
+	{
+		if (reportedIoCmdCnt)
+			xil_printf("IOPS: %d\r\n", reportedIoCmdCnt);
+		reportedIoCmdCnt = 0;
+		tReport = tNow;
+	}
+#endif
+}
+
+// commands taken from the host but still waiting in the io command ring are finished before the queues go away
+void drain_nvme_io_cmd()
+{
+	while (fetch_nvme_io_cmd() || GetSliceReqCnt())
+	{
+		ReqTransSliceToLowLevel();
+		CheckDoneNvmeDmaReq();
+		SchedulingNandReq();
+	}
+
+	SyncAllLowLevelReqDone();
+}
+
 void nvme_main()
 {
-	unsigned int exeLlr;
 	unsigned int rstCnt = 0;
 
 	xil_printf("!!! Wait until FTL reset complete !!! \r\n");
 
 	InitFTL();
+	init_nvme_io_cmd_ring();
 
 	xil_printf("\r\nFTL reset complete!!! \r\n");
 	xil_printf("Turn on the host PC \r\n");
 
 	while (1)
 	{
-		exeLlr = 1;
-
 		if (g_nvmeTask.status == NVME_TASK_WAIT_CC_EN)
 		{
 			unsigned int ccEn;
@@ -116,12 +232,14 @@ void nvme_main()
 		else if (g_nvmeTask.status == NVME_TASK_RUNNING)
 		{
 			NVME_COMMAND nvmeCmd;
-			unsigned int cmdValid;
-
-			cmdValid = get_nvme_cmd(&nvmeCmd.qID, &nvmeCmd.cmdSlotTag, &nvmeCmd.cmdSeqNum, nvmeCmd.cmdDword);
+			unsigned int cmdValid, fetchCnt;
 
-			if (cmdValid == 1)
+			for (fetchCnt = 0; (fetchCnt < NVME_CMD_FETCH_BATCH) && (g_nvmeTask.status == NVME_TASK_RUNNING); fetchCnt++)
 			{
+				cmdValid = get_nvme_cmd(&nvmeCmd.qID, &nvmeCmd.cmdSlotTag, &nvmeCmd.cmdSeqNum, nvmeCmd.cmdDword);
+				if (cmdValid != 1)
+					break;
+
 				rstCnt = 0;
 				if (nvmeCmd.qID == 0)
 				{
@@ -131,8 +249,6 @@ void nvme_main()
 				{
 					// todo
 					handle_nvme_io_cmd(&nvmeCmd);
-					ReqTransSliceToLowLevel();
-					exeLlr = 0;
 				}
 			}
 		}
@@ -145,6 +261,8 @@ void nvme_main()
 				unsigned int qID;
 				set_nvme_csts_shst(1);
 
+				drain_nvme_io_cmd();
+
 				for (qID = 0; qID < 8; qID++)
 				{
 					set_io_cq(qID, 0, 0, 0, 0, 0, 0);
@@ -174,6 +292,9 @@ void nvme_main()
 				set_nvme_csts_shst(0);
 				set_nvme_csts_rdy(0);
 
+				// the host gave up on the commands not split yet, their slot tags are not valid any more
+				init_nvme_io_cmd_ring();
+
 				set_nvme_admin_queue(0, 0, 0);
 				for (qID = 0; qID < 8; qID++)
 				{
@@ -188,6 +309,9 @@ void nvme_main()
 		else if (g_nvmeTask.status == NVME_TASK_RESET)
 		{
 			unsigned int qID;
+
+			init_nvme_io_cmd_ring();
+
 			for (qID = 0; qID < 8; qID++)
 			{
 				set_io_cq(qID, 0, 0, 0, 0, 0, 0);
@@ -258,7 +382,7 @@ void nvme_main()
 					else
 					{
 						// data buffer miss, allocate a new buffer entry
-						dataBufEntry = AllocateDataBuf();
+						dataBufEntry = AllocateDataBuf(reqPoolPtr->reqPool[reqSlotTag].logicalSliceAddr);
 						reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry = dataBufEntry;
 
 						// clear the allocated data buffer entry being used by a previous request
@@ -272,6 +396,8 @@ void nvme_main()
 					reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat = REQ_OPT_DATA_BUF_ENTRY;
 					UpdateDataBufEntryInfoBlockingReq(dataBufEntry, reqSlotTag);
 
+					if (dataBufMapPtr->dataBuf[dataBufEntry].dirty == DATA_BUF_CLEAN)
+						dirtyDataBufCnt++;
 					dataBufMapPtr->dataBuf[dataBufEntry].dirty = DATA_BUF_DIRTY;
 
 					devAddr = (int *)GenerateDataBufAddr(reqSlotTag);
@@ -338,7 +464,7 @@ void nvme_main()
 					else
 					{
 						// data buffer miss, allocate a new buffer entry
-						dataBufEntry = AllocateDataBuf();
+						dataBufEntry = AllocateDataBuf(reqPoolPtr->reqPool[reqSlotTag].logicalSliceAddr);
 						reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry = dataBufEntry;
 
 						// clear the allocated data buffer entry being used by a previous request
@@ -415,38 +541,6 @@ void nvme_main()
 		}
 #endif
 
-		if (exeLlr && ((nvmeDmaReqQ.headReq != REQ_SLOT_TAG_NONE) || notCompletedNandReqCnt || blockedReqCnt))
-		{
-#if 0
-			static unsigned int saved_notCompletedNandReqCnt, saved_blockedReqCnt;
-			static unsigned int check_cnt;
-#endif
-			CheckDoneNvmeDmaReq();
-			SchedulingNandReq();
-
-#if 0
-#if 0
-			if(notCompletedNandReqCnt || blockedReqCnt)
-			{
-				xil_printf("notCompletedNandReqCnt=%d,blockedReqCnt=%d\r\n", notCompletedNandReqCnt, blockedReqCnt);
-			}
-#else
-			if(saved_notCompletedNandReqCnt == notCompletedNandReqCnt && saved_blockedReqCnt == blockedReqCnt)
-			{
-				check_cnt++;
-				if(check_cnt > 10000)
-				{
-					xil_printf("notCompletedNandReqCnt=%d,blockedReqCnt=%d\r\n", notCompletedNandReqCnt, blockedReqCnt);
-				}
-			}
-			else
-			{
-				check_cnt = 0;
-			}
-			saved_notCompletedNandReqCnt = notCompletedNandReqCnt;
-			saved_blockedReqCnt = blockedReqCnt;
-#endif
-#endif
-		}
+		ftl_task();
 	}
 }
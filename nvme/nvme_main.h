@@ -49,5 +49,7 @@
 #define __NVME_MAIN_H_
 
 void nvme_main();
+void drain_nvme_io_cmd();
+void ftl_task();
 
 #endif	//__NVME_MAIN_H_
@@ -49,35 +49,48 @@
 
 P_REQ_POOL reqPoolPtr;
 FREE_REQUEST_QUEUE freeReqQ;
-SLICE_REQUEST_QUEUE sliceReqQ;
+SLICE_REQUEST_QUEUE sliceReqQ[REQ_OPT_IO_CLASS_COUNT];
+unsigned int sliceReqCredit[REQ_OPT_IO_CLASS_COUNT];
+unsigned int sliceReqWrrClass;
+
+extern NVME_CONTEXT g_nvmeTask;
 BLOCKED_BY_BUFFER_DEPENDENCY_REQUEST_QUEUE blockedByBufDepReqQ;
 BLOCKED_BY_ROW_ADDR_DEPENDENCY_REQUEST_QUEUE blockedByRowAddrDepReqQ[USER_CHANNELS][USER_WAYS];
-NVME_DMA_REQUEST_QUEUE nvmeDmaReqQ;
+NVME_DMA_REQUEST_QUEUE nvmeDmaReqQ[NVME_DMA_REQ_Q_COUNT];
 NAND_REQUEST_QUEUE nandReqQ[USER_CHANNELS][USER_WAYS];
 
 unsigned int notCompletedNandReqCnt;
+unsigned int notCompletedNandReqCntOfDie[USER_CHANNELS][USER_WAYS];
 unsigned int blockedReqCnt;
 
 void InitReqPool()
 {
-	int chNo, wayNo, reqSlotTag;
+	int chNo, wayNo, reqSlotTag, ioClass, dmaDir;
 
 	reqPoolPtr = (P_REQ_POOL)REQ_POOL_ADDR; // revise address
 
 	freeReqQ.headReq = 0;
 	freeReqQ.tailReq = AVAILABLE_OUNTSTANDING_REQ_COUNT - 1;
 
-	sliceReqQ.headReq = REQ_SLOT_TAG_NONE;
-	sliceReqQ.tailReq = REQ_SLOT_TAG_NONE;
-	sliceReqQ.reqCnt = 0;
+	for (ioClass = 0; ioClass < REQ_OPT_IO_CLASS_COUNT; ioClass++)
+	{
+		sliceReqQ[ioClass].headReq = REQ_SLOT_TAG_NONE;
+		sliceReqQ[ioClass].tailReq = REQ_SLOT_TAG_NONE;
+		sliceReqQ[ioClass].reqCnt = 0;
+		sliceReqCredit[ioClass] = 0;
+	}
+	sliceReqWrrClass = REQ_OPT_IO_CLASS_HIGH;
 
 	blockedByBufDepReqQ.headReq = REQ_SLOT_TAG_NONE;
 	blockedByBufDepReqQ.tailReq = REQ_SLOT_TAG_NONE;
 	blockedByBufDepReqQ.reqCnt = 0;
 
-	nvmeDmaReqQ.headReq = REQ_SLOT_TAG_NONE;
-	nvmeDmaReqQ.tailReq = REQ_SLOT_TAG_NONE;
-	nvmeDmaReqQ.reqCnt = 0;
+	for (dmaDir = 0; dmaDir < NVME_DMA_REQ_Q_COUNT; dmaDir++)
+	{
+		nvmeDmaReqQ[dmaDir].headReq = REQ_SLOT_TAG_NONE;
+		nvmeDmaReqQ[dmaDir].tailReq = REQ_SLOT_TAG_NONE;
+		nvmeDmaReqQ[dmaDir].reqCnt = 0;
+	}
 
 	for (chNo = 0; chNo < USER_CHANNELS; chNo++)
 		for (wayNo = 0; wayNo < USER_WAYS; wayNo++)
@@ -89,6 +102,8 @@ void InitReqPool()
 			nandReqQ[chNo][wayNo].headReq = REQ_SLOT_TAG_NONE;
 			nandReqQ[chNo][wayNo].tailReq = REQ_SLOT_TAG_NONE;
 			nandReqQ[chNo][wayNo].reqCnt = 0;
+
+			notCompletedNandReqCntOfDie[chNo][wayNo] = 0;
 		}
 
 	for (reqSlotTag = 0; reqSlotTag < AVAILABLE_OUNTSTANDING_REQ_COUNT; reqSlotTag++)
@@ -153,6 +168,8 @@ unsigned int GetFromFreeReqQ()
 	}
 
 	reqPoolPtr->reqPool[reqSlotTag].reqQueueType = REQ_QUEUE_TYPE_NONE;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.ioClass = REQ_OPT_IO_CLASS_LOW;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.rowAddrDepPostErase = REQ_OPT_ROW_ADDR_DEP_PRE_ERASE;
 	freeReqQ.reqCnt--;
 
 	return reqSlotTag;
@@ -160,51 +177,103 @@ unsigned int GetFromFreeReqQ()
 
 void PutToSliceReqQ(unsigned int reqSlotTag)
 {
-	if (sliceReqQ.tailReq != REQ_SLOT_TAG_NONE)
+	unsigned int ioClass;
+
+	ioClass = reqPoolPtr->reqPool[reqSlotTag].reqOpt.ioClass;
+
+	if (sliceReqQ[ioClass].tailReq != REQ_SLOT_TAG_NONE)
 	{
-		reqPoolPtr->reqPool[reqSlotTag].prevReq = sliceReqQ.tailReq;
+		reqPoolPtr->reqPool[reqSlotTag].prevReq = sliceReqQ[ioClass].tailReq;
 		reqPoolPtr->reqPool[reqSlotTag].nextReq = REQ_SLOT_TAG_NONE;
-		reqPoolPtr->reqPool[sliceReqQ.tailReq].nextReq = reqSlotTag;
-		sliceReqQ.tailReq = reqSlotTag;
+		reqPoolPtr->reqPool[sliceReqQ[ioClass].tailReq].nextReq = reqSlotTag;
+		sliceReqQ[ioClass].tailReq = reqSlotTag;
 	}
 	else
 	{
 		reqPoolPtr->reqPool[reqSlotTag].prevReq = REQ_SLOT_TAG_NONE;
 		reqPoolPtr->reqPool[reqSlotTag].nextReq = REQ_SLOT_TAG_NONE;
-		sliceReqQ.headReq = reqSlotTag;
-		sliceReqQ.tailReq = reqSlotTag;
+		sliceReqQ[ioClass].headReq = reqSlotTag;
+		sliceReqQ[ioClass].tailReq = reqSlotTag;
 	}
 
 	reqPoolPtr->reqPool[reqSlotTag].reqQueueType = REQ_QUEUE_TYPE_SLICE;
-	sliceReqQ.reqCnt++;
+	sliceReqQ[ioClass].reqCnt++;
 }
 
-unsigned int GetFromSliceReqQ()
+// urgent class first, then weighted round robin over the high, medium and low classes
+unsigned int SelectSliceReqClass()
 {
-	unsigned int reqSlotTag;
+	ADMIN_SET_FEATURES_ARBITRATION_DW11 arbitration;
+	unsigned int ioClass, loop;
 
-	reqSlotTag = sliceReqQ.headReq;
+	if (sliceReqQ[REQ_OPT_IO_CLASS_URGENT].headReq != REQ_SLOT_TAG_NONE)
+		return REQ_OPT_IO_CLASS_URGENT;
 
-	if (reqSlotTag == REQ_SLOT_TAG_NONE)
+	for (loop = 0; loop < 2 * (REQ_OPT_IO_CLASS_COUNT - 1); loop++)
+	{
+		ioClass = sliceReqWrrClass;
+		if ((sliceReqQ[ioClass].headReq != REQ_SLOT_TAG_NONE) && sliceReqCredit[ioClass])
+		{
+			sliceReqCredit[ioClass]--;
+			return ioClass;
+		}
+
+		// the class is idle or out of credit, hand the turn over to the next class
+		sliceReqCredit[ioClass] = 0;
+		if (ioClass == REQ_OPT_IO_CLASS_LOW)
+		{
+			// every class used up its turn, start a new round with the weights set by the host
+			arbitration.dword = g_nvmeTask.arbitration;
+			sliceReqCredit[REQ_OPT_IO_CLASS_HIGH] = arbitration.HPW + 1;
+			sliceReqCredit[REQ_OPT_IO_CLASS_MEDIUM] = arbitration.MPW + 1;
+			sliceReqCredit[REQ_OPT_IO_CLASS_LOW] = arbitration.LPW + 1;
+			sliceReqWrrClass = REQ_OPT_IO_CLASS_HIGH;
+		}
+		else
+			sliceReqWrrClass = ioClass + 1;
+	}
+
+	return REQ_OPT_IO_CLASS_COUNT;
+}
+
+unsigned int GetFromSliceReqQ()
+{
+	unsigned int reqSlotTag, ioClass;
+
+	ioClass = SelectSliceReqClass();
+	if (ioClass == REQ_OPT_IO_CLASS_COUNT)
 		return REQ_SLOT_TAG_FAIL;
 
+	reqSlotTag = sliceReqQ[ioClass].headReq;
+
 	if (reqPoolPtr->reqPool[reqSlotTag].nextReq != REQ_SLOT_TAG_NONE)
 	{
-		sliceReqQ.headReq = reqPoolPtr->reqPool[reqSlotTag].nextReq;
+		sliceReqQ[ioClass].headReq = reqPoolPtr->reqPool[reqSlotTag].nextReq;
 		reqPoolPtr->reqPool[reqPoolPtr->reqPool[reqSlotTag].nextReq].prevReq = REQ_SLOT_TAG_NONE;
 	}
 	else
 	{
-		sliceReqQ.headReq = REQ_SLOT_TAG_NONE;
-		sliceReqQ.tailReq = REQ_SLOT_TAG_NONE;
+		sliceReqQ[ioClass].headReq = REQ_SLOT_TAG_NONE;
+		sliceReqQ[ioClass].tailReq = REQ_SLOT_TAG_NONE;
 	}
 
 	reqPoolPtr->reqPool[reqSlotTag].reqQueueType = REQ_QUEUE_TYPE_NONE;
-	sliceReqQ.reqCnt--;
+	sliceReqQ[ioClass].reqCnt--;
 
 	return reqSlotTag;
 }
 
+unsigned int GetSliceReqCnt()
+{
+	unsigned int ioClass, reqCnt;
+
+	reqCnt = 0;
+	for (ioClass = 0; ioClass < REQ_OPT_IO_CLASS_COUNT; ioClass++)
+		reqCnt += sliceReqQ[ioClass].reqCnt;
+
+	return reqCnt;
+}
+
 void PutToBlockedByBufDepReqQ(unsigned int reqSlotTag)
 {
 	if (blockedByBufDepReqQ.tailReq != REQ_SLOT_TAG_NONE)
@@ -321,69 +390,65 @@ void SelectiveGetFromBlockedByRowAddrDepReqQ(unsigned int reqSlotTag, unsigned i
 
 void PutToNvmeDmaReqQ(unsigned int reqSlotTag)
 {
+	unsigned int dmaDir;
+
+	// 按 DMA 方向放入各自的有序队列
+	if (reqPoolPtr->reqPool[reqSlotTag].reqCode == REQ_CODE_RxDMA)
+		dmaDir = NVME_DMA_REQ_Q_RX;
+	else
+		dmaDir = NVME_DMA_REQ_Q_TX;
+
 	// 如果当前 DMA 请求队列的尾部请求不是空
-	if (nvmeDmaReqQ.tailReq != REQ_SLOT_TAG_NONE)
+	if (nvmeDmaReqQ[dmaDir].tailReq != REQ_SLOT_TAG_NONE)
 	{
 		// 将当前请求加入到队列的尾部
-		// 设置当前请求的前一个请求为当前队列的尾部
-		reqPoolPtr->reqPool[reqSlotTag].prevReq = nvmeDmaReqQ.tailReq;
-		// 设置当前请求的下一个请求为空
+		reqPoolPtr->reqPool[reqSlotTag].prevReq = nvmeDmaReqQ[dmaDir].tailReq;
 		reqPoolPtr->reqPool[reqSlotTag].nextReq = REQ_SLOT_TAG_NONE;
-		// 更新队列尾部请求的 nextReq 指向当前请求
-		reqPoolPtr->reqPool[nvmeDmaReqQ.tailReq].nextReq = reqSlotTag;
-		// 更新队列尾部指针为当前请求
-		nvmeDmaReqQ.tailReq = reqSlotTag;
+		reqPoolPtr->reqPool[nvmeDmaReqQ[dmaDir].tailReq].nextReq = reqSlotTag;
+		nvmeDmaReqQ[dmaDir].tailReq = reqSlotTag;
 	}
 	else
 	{
 		// 如果队列为空，当前请求将成为队列的唯一元素
-		// 设置当前请求的前一个请求和下一个请求都为空
 		reqPoolPtr->reqPool[reqSlotTag].prevReq = REQ_SLOT_TAG_NONE;
 		reqPoolPtr->reqPool[reqSlotTag].nextReq = REQ_SLOT_TAG_NONE;
-		// 设置队列的头部和尾部都指向当前请求
-		nvmeDmaReqQ.headReq = reqSlotTag;
-		nvmeDmaReqQ.tailReq = reqSlotTag;
+		nvmeDmaReqQ[dmaDir].headReq = reqSlotTag;
+		nvmeDmaReqQ[dmaDir].tailReq = reqSlotTag;
 	}
 
 	// 设置当前请求的队列类型为 NVME_DMA 队列
 	reqPoolPtr->reqPool[reqSlotTag].reqQueueType = REQ_QUEUE_TYPE_NVME_DMA;
 	// 增加 DMA 请求队列中的请求数量
-	nvmeDmaReqQ.reqCnt++;
+	nvmeDmaReqQ[dmaDir].reqCnt++;
 }
 
-void SelectiveGetFromNvmeDmaReqQ(unsigned int reqSlotTag)
+// retires the oldest request of a direction, the caller has checked that its dma is done
+unsigned int GetFromNvmeDmaReqQ(unsigned int dmaDir)
 {
-	unsigned int prevReq, nextReq;
+	unsigned int reqSlotTag;
 
-	prevReq = reqPoolPtr->reqPool[reqSlotTag].prevReq;
-	nextReq = reqPoolPtr->reqPool[reqSlotTag].nextReq;
+	reqSlotTag = nvmeDmaReqQ[dmaDir].headReq;
+	if (reqSlotTag == REQ_SLOT_TAG_NONE)
+		return REQ_SLOT_TAG_NONE;
 
-	if ((nextReq != REQ_SLOT_TAG_NONE) && (prevReq != REQ_SLOT_TAG_NONE))
-	{
-		reqPoolPtr->reqPool[prevReq].nextReq = nextReq;
-		reqPoolPtr->reqPool[nextReq].prevReq = prevReq;
-	}
-	else if ((nextReq == REQ_SLOT_TAG_NONE) && (prevReq != REQ_SLOT_TAG_NONE))
-	{
-		reqPoolPtr->reqPool[prevReq].nextReq = REQ_SLOT_TAG_NONE;
-		nvmeDmaReqQ.tailReq = prevReq;
-	}
-	else if ((nextReq != REQ_SLOT_TAG_NONE) && (prevReq == REQ_SLOT_TAG_NONE))
+	if (reqPoolPtr->reqPool[reqSlotTag].nextReq != REQ_SLOT_TAG_NONE)
 	{
-		reqPoolPtr->reqPool[nextReq].prevReq = REQ_SLOT_TAG_NONE;
-		nvmeDmaReqQ.headReq = nextReq;
+		nvmeDmaReqQ[dmaDir].headReq = reqPoolPtr->reqPool[reqSlotTag].nextReq;
+		reqPoolPtr->reqPool[reqPoolPtr->reqPool[reqSlotTag].nextReq].prevReq = REQ_SLOT_TAG_NONE;
 	}
 	else
 	{
-		nvmeDmaReqQ.headReq = REQ_SLOT_TAG_NONE;
-		nvmeDmaReqQ.tailReq = REQ_SLOT_TAG_NONE;
+		nvmeDmaReqQ[dmaDir].headReq = REQ_SLOT_TAG_NONE;
+		nvmeDmaReqQ[dmaDir].tailReq = REQ_SLOT_TAG_NONE;
 	}
 
 	reqPoolPtr->reqPool[reqSlotTag].reqQueueType = REQ_QUEUE_TYPE_NONE;
-	nvmeDmaReqQ.reqCnt--;
+	nvmeDmaReqQ[dmaDir].reqCnt--;
 
 	PutToFreeReqQ(reqSlotTag);
 	ReleaseBlockedByBufDepReq(reqSlotTag);
+
+	return reqSlotTag;
 }
 
 void PutToNandReqQ(unsigned int reqSlotTag, unsigned chNo, unsigned wayNo)
@@ -405,6 +470,7 @@ void PutToNandReqQ(unsigned int reqSlotTag, unsigned chNo, unsigned wayNo)
 
 	reqPoolPtr->reqPool[reqSlotTag].reqQueueType = REQ_QUEUE_TYPE_NAND;
 	nandReqQ[chNo][wayNo].reqCnt++;
+	notCompletedNandReqCntOfDie[chNo][wayNo]++;
 	notCompletedNandReqCnt++;
 }
 
@@ -429,8 +495,12 @@ void GetFromNandReqQ(unsigned int chNo, unsigned int wayNo, unsigned int reqStat
 
 	reqPoolPtr->reqPool[reqSlotTag].reqQueueType = REQ_QUEUE_TYPE_NONE;
 	nandReqQ[chNo][wayNo].reqCnt--;
+	notCompletedNandReqCntOfDie[chNo][wayNo]--;
 	notCompletedNandReqCnt--;
 
+	if (reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat == REQ_OPT_DATA_BUF_MERGE_ENTRY)
+		CopyMergedDataBufEntry(reqSlotTag);
+
 	PutToFreeReqQ(reqSlotTag);
 	ReleaseBlockedByBufDepReq(reqSlotTag);
 }
@@ -52,6 +52,9 @@
 
 #define	AVAILABLE_OUNTSTANDING_REQ_COUNT			((USER_DIES) * 128)  //regardless of request type
 
+// new host commands are not fetched below this many free requests, the rest is left to gc and buffer write back
+#define FREE_REQ_HOST_FETCH_WATERMARK	(AVAILABLE_OUNTSTANDING_REQ_COUNT / 4)
+
 #define REQ_SLOT_TAG_NONE		0xffff
 #define REQ_SLOT_TAG_FAIL		0xffff
 
@@ -66,7 +69,9 @@ void PutToFreeReqQ(unsigned int reqSlotTag);
 unsigned int GetFromFreeReqQ();
 
 void PutToSliceReqQ(unsigned int reqSlotTag);
+unsigned int SelectSliceReqClass();
 unsigned int GetFromSliceReqQ();
+unsigned int GetSliceReqCnt();
 
 void PutToBlockedByBufDepReqQ(unsigned int reqSlotTag);
 void SelectiveGetFromBlockedByBufDepReqQ(unsigned int reqSlotTag);
@@ -75,20 +80,22 @@ void PutToBlockedByRowAddrDepReqQ(unsigned int reqSlotTag, unsigned int chNo, un
 void SelectiveGetFromBlockedByRowAddrDepReqQ(unsigned int reqSlotTag, unsigned int chNo, unsigned int wayNo);
 
 void PutToNvmeDmaReqQ(unsigned int reqSlotTag);
-void SelectiveGetFromNvmeDmaReqQ(unsigned int regSlotTag);
+unsigned int GetFromNvmeDmaReqQ(unsigned int dmaDir);
 
 void PutToNandReqQ(unsigned int reqSlotTag, unsigned chNo, unsigned wayNo);
 void GetFromNandReqQ(unsigned int chNo, unsigned int wayNo, unsigned int reqStatus, unsigned int reqCode);
 
+
 extern P_REQ_POOL reqPoolPtr;
 extern FREE_REQUEST_QUEUE freeReqQ;
-extern SLICE_REQUEST_QUEUE sliceReqQ;
+extern SLICE_REQUEST_QUEUE sliceReqQ[REQ_OPT_IO_CLASS_COUNT];
 extern BLOCKED_BY_BUFFER_DEPENDENCY_REQUEST_QUEUE blockedByBufDepReqQ;
 extern BLOCKED_BY_ROW_ADDR_DEPENDENCY_REQUEST_QUEUE blockedByRowAddrDepReqQ[USER_CHANNELS][USER_WAYS];
-extern NVME_DMA_REQUEST_QUEUE nvmeDmaReqQ;
+extern NVME_DMA_REQUEST_QUEUE nvmeDmaReqQ[NVME_DMA_REQ_Q_COUNT];
 extern NAND_REQUEST_QUEUE nandReqQ[USER_CHANNELS][USER_WAYS];
 
 extern unsigned int notCompletedNandReqCnt;
+extern unsigned int notCompletedNandReqCntOfDie[USER_CHANNELS][USER_WAYS];
 extern unsigned int blockedReqCnt;
 
 #endif /* REQUEST_ALLOCATION_H_ */
@@ -80,6 +80,8 @@
 #define REQ_OPT_DATA_BUF_TEMP_ENTRY 1
 #define REQ_OPT_DATA_BUF_ADDR 2
 #define REQ_OPT_DATA_BUF_NONE 3
+#define REQ_OPT_DATA_BUF_BYPASS_ENTRY 4
+#define REQ_OPT_DATA_BUF_MERGE_ENTRY 5
 
 #define REQ_OPT_NAND_ADDR_VSA 0
 #define REQ_OPT_NAND_ADDR_PHY_ORG 1
@@ -96,9 +98,20 @@
 #define REQ_OPT_ROW_ADDR_DEPENDENCY_NONE 0
 #define REQ_OPT_ROW_ADDR_DEPENDENCY_CHECK 1
 
+// a read of a page programmed after a pending erase of its block, it waits behind the erase without holding it back
+#define REQ_OPT_ROW_ADDR_DEP_PRE_ERASE 0
+#define REQ_OPT_ROW_ADDR_DEP_POST_ERASE 1
+
 #define REQ_OPT_BLOCK_SPACE_MAIN 0
 #define REQ_OPT_BLOCK_SPACE_TOTAL 1
 
+// same encoding as the queue priority of the nvme submission queue
+#define REQ_OPT_IO_CLASS_URGENT 0
+#define REQ_OPT_IO_CLASS_HIGH 1
+#define REQ_OPT_IO_CLASS_MEDIUM 2
+#define REQ_OPT_IO_CLASS_LOW 3
+#define REQ_OPT_IO_CLASS_COUNT 4
+
 #define LOGICAL_SLICE_ADDR_NONE 0xffffffff
 
 typedef struct _DATA_BUF_INFO
@@ -146,13 +159,15 @@ typedef struct _NAND_INFO
 
 typedef struct _REQ_OPTION
 {
-	unsigned int dataBufFormat : 2;
+	unsigned int dataBufFormat : 3;
 	unsigned int nandAddr : 2;
 	unsigned int nandEcc : 1;
 	unsigned int nandEccWarning : 1;
 	unsigned int rowAddrDependencyCheck : 1;
 	unsigned int blockSpace : 1;
-	unsigned int reserved0 : 24;
+	unsigned int ioClass : 2;
+	unsigned int rowAddrDepPostErase : 1;
+	unsigned int reserved0 : 20;
 } REQ_OPTION, *P_REQ_OPTION;
 
 typedef struct _SSD_REQ_FORMAT
@@ -86,6 +86,11 @@ typedef struct _NVME_DMA_REQUEST_QUEUE
 	unsigned int reserved0 : 16;
 } NVME_DMA_REQUEST_QUEUE, *P_NVME_DMA_REQUEST_QUEUE;
 
+// auto dma completes in issue order per direction, so each direction keeps its own ordered queue
+#define NVME_DMA_REQ_Q_RX		0
+#define NVME_DMA_REQ_Q_TX		1
+#define NVME_DMA_REQ_Q_COUNT	2
+
 typedef struct _NAND_REQUEST_QUEUE
 {
 	unsigned int headReq : 16;
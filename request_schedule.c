@@ -51,6 +51,14 @@
 #include "memory_map.h"
 #include "nvme/debug.h"
 
+// #define NAND_SCHEDULER_PROFILE
+
+#ifdef NAND_SCHEDULER_PROFILE
+#include "xtime_l.h"
+
+#define NAND_SCHEDULER_PROFILE_PASS_COUNT	1000000
+#endif
+
 P_COMPLETE_FLAG_TABLE completeFlagTablePtr;
 P_STATUS_REPORT_TABLE statusReportTablePtr;
 P_ERROR_INFO_TABLE eccErrorInfoTablePtr;
@@ -73,34 +81,24 @@ void InitReqScheduler()
 
 	for(chNo=0; chNo<USER_CHANNELS; ++chNo)
 	{
-		wayPriorityTablePtr->wayPriority[chNo].idleHead = 0;
-		wayPriorityTablePtr->wayPriority[chNo].idleTail = USER_WAYS - 1;
-		wayPriorityTablePtr->wayPriority[chNo].statusReportHead = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].statusReportTail = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].eraseHead = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].eraseTail = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].readTriggerHead = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].readTriggerTail = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].writeHead = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].writeTail = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].readTransferHead = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].readTransferTail = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].statusCheckHead = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].statusCheckTail = WAY_NONE;
+		wayPriorityTablePtr->wayPriority[chNo].idleMask = WAY_BIT(USER_WAYS) - 1;
+		wayPriorityTablePtr->wayPriority[chNo].statusReportMask = 0;
+		wayPriorityTablePtr->wayPriority[chNo].eraseMask = 0;
+		wayPriorityTablePtr->wayPriority[chNo].readTriggerMask = 0;
+		wayPriorityTablePtr->wayPriority[chNo].writeMask = 0;
+		wayPriorityTablePtr->wayPriority[chNo].readTransferMask = 0;
+		wayPriorityTablePtr->wayPriority[chNo].statusCheckMask = 0;
+		wayPriorityTablePtr->wayPriority[chNo].issueStartWay = 0;
 
 		for(wayNo=0; wayNo<USER_WAYS; ++wayNo)
 		{
 			dieStateTablePtr->dieState[chNo][wayNo].dieState = DIE_STATE_IDLE;
 			dieStateTablePtr->dieState[chNo][wayNo].reqStatusCheckOpt = REQ_STATUS_CHECK_OPT_NONE;
-			dieStateTablePtr->dieState[chNo][wayNo].prevWay = wayNo - 1;
-			dieStateTablePtr->dieState[chNo][wayNo].nextWay = wayNo + 1;
 
 			completeFlagTablePtr->completeFlag[chNo][wayNo] = 0;
 			statusReportTablePtr->statusReport[chNo][wayNo] = 0;
 			retryLimitTablePtr->retryLimit[chNo][wayNo] = RETRY_LIMIT;
 		}
-		dieStateTablePtr->dieState[chNo][0].prevWay = WAY_NONE;
-		dieStateTablePtr->dieState[chNo][USER_WAYS-1].nextWay = WAY_NONE;
 	}
 }
 
@@ -108,7 +106,7 @@ void InitReqScheduler()
 
 void SyncAllLowLevelReqDone()
 {
-	while((nvmeDmaReqQ.headReq != REQ_SLOT_TAG_NONE) || notCompletedNandReqCnt || blockedReqCnt)
+	while((nvmeDmaReqQ[NVME_DMA_REQ_Q_RX].headReq != REQ_SLOT_TAG_NONE) || (nvmeDmaReqQ[NVME_DMA_REQ_Q_TX].headReq != REQ_SLOT_TAG_NONE) || notCompletedNandReqCnt || blockedReqCnt)
 	{
 		CheckDoneNvmeDmaReq();
 		SchedulingNandReq();
@@ -124,9 +122,18 @@ void SyncAvailFreeReq()
 	}
 }
 
-void SyncReleaseEraseReq(unsigned int chNo, unsigned int wayNo, unsigned int blockNo)
+void SyncAvailBypassDataBuf()
+{
+	while(bypassDataBufMapPtr->bypassDataBuf[bypassDataBufMapPtr->nextEntry].blockingReqTail != REQ_SLOT_TAG_NONE)
+	{
+		CheckDoneNvmeDmaReq();
+		SchedulingNandReq();
+	}
+}
+
+void SyncMergedDataBufEntry(unsigned int dataBufEntry)
 {
-	while(rowAddrDependencyTablePtr->block[chNo][wayNo][blockNo].blockedEraseReqFlag)
+	while(dataBufMapPtr->dataBuf[dataBufEntry].mergeMask)
 	{
 		CheckDoneNvmeDmaReq();
 		SchedulingNandReq();
@@ -136,48 +143,98 @@ void SyncReleaseEraseReq(unsigned int chNo, unsigned int wayNo, unsigned int blo
 void SchedulingNandReq()
 {
 	int chNo;
+#ifdef NAND_SCHEDULER_PROFILE
+	static XTime schedulingTime = 0;
+	static unsigned int schedulingPassCnt = 0;
+	XTime tStart, tEnd;
+
+	XTime_GetTime(&tStart);
+#endif
 
 	for(chNo = 0; chNo < USER_CHANNELS; chNo++)
 		SchedulingNandReqPerCh(chNo);
+
+#ifdef NAND_SCHEDULER_PROFILE
+	XTime_GetTime(&tEnd);
+	schedulingTime += tEnd - tStart;
+	schedulingPassCnt++;
+
+	if(schedulingPassCnt == NAND_SCHEDULER_PROFILE_PASS_COUNT)
+	{
+		xil_printf("SchedulingNandReq: %d ticks per pass (%d passes)\r\n", (unsigned int)(schedulingTime / schedulingPassCnt), schedulingPassCnt);
+		schedulingTime = 0;
+		schedulingPassCnt = 0;
+	}
+#endif
+}
+
+unsigned int SelectWayFromMask(unsigned int wayMask, unsigned int startWay)
+{
+	unsigned int upperWayMask;
+
+	//lowest way at or above startWay first, then wrap around to way 0
+	upperWayMask = wayMask & ~(WAY_BIT(startWay) - 1);
+	if(upperWayMask)
+		return __builtin_ctz(upperWayMask);
+
+	return __builtin_ctz(wayMask);
+}
+
+unsigned int SelectIssueWay(unsigned int chNo, unsigned int wayMask)
+{
+	unsigned int wayNo, urgentWayMask, candidateMask;
+
+	//ways heading an urgent class request go first, per-die order is left untouched
+	urgentWayMask = 0;
+	candidateMask = wayMask;
+	while(candidateMask)
+	{
+		wayNo = __builtin_ctz(candidateMask);
+		candidateMask &= ~WAY_BIT(wayNo);
+
+		if(reqPoolPtr->reqPool[nandReqQ[chNo][wayNo].headReq].reqOpt.ioClass == REQ_OPT_IO_CLASS_URGENT)
+			urgentWayMask |= WAY_BIT(wayNo);
+	}
+
+	if(urgentWayMask)
+		wayMask = urgentWayMask;
+
+	return SelectWayFromMask(wayMask, wayPriorityTablePtr->wayPriority[chNo].issueStartWay);
 }
 
 void SchedulingNandReqPerCh(unsigned int chNo)
 {
-	unsigned int readyBusy, wayNo, reqStatus, nextWay, waitWayCnt;
+	unsigned int readyBusy, wayNo, reqStatus, wayMask, waitWayCnt;
 
 	waitWayCnt = 0;
-	if(wayPriorityTablePtr->wayPriority[chNo].idleHead != WAY_NONE)
+	wayMask = wayPriorityTablePtr->wayPriority[chNo].idleMask;
+	while(wayMask)
 	{
-		wayNo = wayPriorityTablePtr->wayPriority[chNo].idleHead;
+		wayNo = __builtin_ctz(wayMask);
+		wayMask &= ~WAY_BIT(wayNo);
 
-		while(wayNo != WAY_NONE)
-		{
-			if(nandReqQ[chNo][wayNo].headReq == REQ_SLOT_TAG_NONE)
-				ReleaseBlockedByRowAddrDepReq(chNo, wayNo);
-
-			if(nandReqQ[chNo][wayNo].headReq != REQ_SLOT_TAG_NONE)
-			{
-				nextWay = dieStateTablePtr->dieState[chNo][wayNo].nextWay;
+		if(nandReqQ[chNo][wayNo].headReq == REQ_SLOT_TAG_NONE)
+			ReleaseBlockedByRowAddrDepReq(chNo, wayNo);
 
-				SelectivGetFromNandIdleList(chNo, wayNo);
-				PutToNandWayPriorityTable(nandReqQ[chNo][wayNo].headReq, chNo, wayNo);
-				wayNo = nextWay;
-			}
-			else
-			{
-				wayNo = dieStateTablePtr->dieState[chNo][wayNo].nextWay;
-				
-				waitWayCnt++;
-			}
+		if(nandReqQ[chNo][wayNo].headReq != REQ_SLOT_TAG_NONE)
+		{
+			SelectivGetFromNandIdleList(chNo, wayNo);
+			PutToNandWayPriorityTable(nandReqQ[chNo][wayNo].headReq, chNo, wayNo);
 		}
+		else
+			waitWayCnt++;
 	}
-	if(wayPriorityTablePtr->wayPriority[chNo].statusReportHead != WAY_NONE)
+
+	wayMask = wayPriorityTablePtr->wayPriority[chNo].statusReportMask;
+	if(wayMask)
 	{
 		readyBusy = V2FReadyBusyAsync(&chCtlReg[chNo]);
-		wayNo = wayPriorityTablePtr->wayPriority[chNo].statusReportHead;
 
-		while(wayNo != WAY_NONE)
+		while(wayMask)
 		{
+			wayNo = __builtin_ctz(wayMask);
+			wayMask &= ~WAY_BIT(wayNo);
+
 			if(V2FWayReady(readyBusy, wayNo))
 			{
 				reqStatus = CheckReqStatus(chNo, wayNo);
@@ -185,7 +242,6 @@ void SchedulingNandReqPerCh(unsigned int chNo)
 				if(reqStatus != REQ_STATUS_RUNNING)
 				{
 					ExecuteNandReq(chNo, wayNo, reqStatus);
-					nextWay = dieStateTablePtr->dieState[chNo][wayNo].nextWay;
 					SelectivGetFromNandStatusReportList(chNo, wayNo);
 
 					if(nandReqQ[chNo][wayNo].headReq == REQ_SLOT_TAG_NONE)
@@ -198,40 +254,33 @@ void SchedulingNandReqPerCh(unsigned int chNo)
 						PutToNandIdleList(chNo, wayNo);
 						waitWayCnt++;
 					}
-
-					wayNo = nextWay;
 				}
 				else if(dieStateTablePtr->dieState[chNo][wayNo].reqStatusCheckOpt  == REQ_STATUS_CHECK_OPT_CHECK)
 				{
-					nextWay = dieStateTablePtr->dieState[chNo][wayNo].nextWay;
 					SelectivGetFromNandStatusReportList(chNo, wayNo);
-
 					PutToNandStatusCheckList(chNo, wayNo);
-					wayNo = nextWay;
 				}
 				else
-				{
-					wayNo = dieStateTablePtr->dieState[chNo][wayNo].nextWay;
 					waitWayCnt++;
-				}
 			}
 			else
-			{
-				wayNo = dieStateTablePtr->dieState[chNo][wayNo].nextWay;
 				waitWayCnt++;
-			}
 		}
 	}
+
 	if(waitWayCnt != USER_WAYS)
 		if(!V2FIsControllerBusy(&chCtlReg[chNo]))
 		{
-			if(wayPriorityTablePtr->wayPriority[chNo].statusCheckHead != WAY_NONE)
+			wayMask = wayPriorityTablePtr->wayPriority[chNo].statusCheckMask;
+			if(wayMask)
 			{
 				readyBusy = V2FReadyBusyAsync(&chCtlReg[chNo]);
-				wayNo = wayPriorityTablePtr->wayPriority[chNo].statusCheckHead;
 
-				while(wayNo != WAY_NONE)
+				while(wayMask)
 				{
+					wayNo = __builtin_ctz(wayMask);
+					wayMask &= ~WAY_BIT(wayNo);
+
 					if(V2FWayReady(readyBusy, wayNo))
 					{
 						reqStatus = CheckReqStatus(chNo, wayNo);
@@ -242,79 +291,72 @@ void SchedulingNandReqPerCh(unsigned int chNo)
 						if(V2FIsControllerBusy(&chCtlReg[chNo]))
 							return;
 					}
-
-					wayNo = dieStateTablePtr->dieState[chNo][wayNo].nextWay;
 				}
 			}
-			if(wayPriorityTablePtr->wayPriority[chNo].readTriggerHead != WAY_NONE)
-			{
-				wayNo = wayPriorityTablePtr->wayPriority[chNo].readTriggerHead;
 
-				while(wayNo != WAY_NONE)
-				{
-					ExecuteNandReq(chNo, wayNo, REQ_STATUS_RUNNING);
+			//issue lists are served round-robin from the way next to the last issued one, urgent ways first
+			wayMask = wayPriorityTablePtr->wayPriority[chNo].readTriggerMask;
+			while(wayMask)
+			{
+				wayNo = SelectIssueWay(chNo, wayMask);
+				wayMask &= ~WAY_BIT(wayNo);
 
-					SelectiveGetFromNandReadTriggerList(chNo, wayNo);
-					PutToNandStatusCheckList(chNo, wayNo);
+				ExecuteNandReq(chNo, wayNo, REQ_STATUS_RUNNING);
 
-					if(V2FIsControllerBusy(&chCtlReg[chNo]))
-						return;
+				SelectiveGetFromNandReadTriggerList(chNo, wayNo);
+				PutToNandStatusCheckList(chNo, wayNo);
+				wayPriorityTablePtr->wayPriority[chNo].issueStartWay = (wayNo + 1) % USER_WAYS;
 
-					wayNo = dieStateTablePtr->dieState[chNo][wayNo].nextWay;
-				}
+				if(V2FIsControllerBusy(&chCtlReg[chNo]))
+					return;
 			}
 
-			if(wayPriorityTablePtr->wayPriority[chNo].eraseHead != WAY_NONE)
+			wayMask = wayPriorityTablePtr->wayPriority[chNo].eraseMask;
+			while(wayMask)
 			{
-				wayNo = wayPriorityTablePtr->wayPriority[chNo].eraseHead;
+				wayNo = SelectIssueWay(chNo, wayMask);
+				wayMask &= ~WAY_BIT(wayNo);
 
+				ExecuteNandReq(chNo, wayNo, REQ_STATUS_RUNNING);
 
-				while(wayNo != WAY_NONE)
-				{
-					ExecuteNandReq(chNo, wayNo, REQ_STATUS_RUNNING);
+				SelectiveGetFromNandEraseList(chNo, wayNo);
+				PutToNandStatusCheckList(chNo, wayNo);
+				wayPriorityTablePtr->wayPriority[chNo].issueStartWay = (wayNo + 1) % USER_WAYS;
 
-					SelectiveGetFromNandEraseList(chNo, wayNo);
-					PutToNandStatusCheckList(chNo, wayNo);
-
-					if(V2FIsControllerBusy(&chCtlReg[chNo]))
-						return;
-
-					wayNo = dieStateTablePtr->dieState[chNo][wayNo].nextWay;
-				}
+				if(V2FIsControllerBusy(&chCtlReg[chNo]))
+					return;
 			}
-			if(wayPriorityTablePtr->wayPriority[chNo].writeHead != WAY_NONE)
-			{
-				wayNo = wayPriorityTablePtr->wayPriority[chNo].writeHead;
 
-				while(wayNo != WAY_NONE)
-				{
-					ExecuteNandReq(chNo, wayNo, REQ_STATUS_RUNNING);
+			wayMask = wayPriorityTablePtr->wayPriority[chNo].writeMask;
+			while(wayMask)
+			{
+				wayNo = SelectIssueWay(chNo, wayMask);
+				wayMask &= ~WAY_BIT(wayNo);
 
-					SelectiveGetFromNandWriteList(chNo, wayNo);
-					PutToNandStatusCheckList(chNo, wayNo);
+				ExecuteNandReq(chNo, wayNo, REQ_STATUS_RUNNING);
 
-					if(V2FIsControllerBusy(&chCtlReg[chNo]))
-						return;
+				SelectiveGetFromNandWriteList(chNo, wayNo);
+				PutToNandStatusCheckList(chNo, wayNo);
+				wayPriorityTablePtr->wayPriority[chNo].issueStartWay = (wayNo + 1) % USER_WAYS;
 
-					wayNo = dieStateTablePtr->dieState[chNo][wayNo].nextWay;
-				}
+				if(V2FIsControllerBusy(&chCtlReg[chNo]))
+					return;
 			}
-			if(wayPriorityTablePtr->wayPriority[chNo].readTransferHead != WAY_NONE)
-			{
-				wayNo = wayPriorityTablePtr->wayPriority[chNo].readTransferHead;
 
-				while(wayNo != WAY_NONE)
-				{
-					ExecuteNandReq(chNo, wayNo, REQ_STATUS_RUNNING);
+			wayMask = wayPriorityTablePtr->wayPriority[chNo].readTransferMask;
+			while(wayMask)
+			{
+				wayNo = SelectIssueWay(chNo, wayMask);
+				wayMask &= ~WAY_BIT(wayNo);
 
-					SelectiveGetFromNandReadTransferList(chNo, wayNo);
-					PutToNandStatusReportList(chNo, wayNo);
+				ExecuteNandReq(chNo, wayNo, REQ_STATUS_RUNNING);
 
-					if(V2FIsControllerBusy(&chCtlReg[chNo]))
-						return;
+				SelectiveGetFromNandReadTransferList(chNo, wayNo);
+				PutToNandStatusReportList(chNo, wayNo);
+				wayPriorityTablePtr->wayPriority[chNo].issueStartWay = (wayNo + 1) % USER_WAYS;
 
-					wayNo = dieStateTablePtr->dieState[chNo][wayNo].nextWay;
-				}
+				if(V2FIsControllerBusy(&chCtlReg[chNo]))
+					return;
 			}
 		}
 
@@ -339,304 +381,72 @@ void PutToNandWayPriorityTable(unsigned int reqSlotTag, unsigned int chNo, unsig
 
 void PutToNandIdleList(unsigned int chNo, unsigned int wayNo)
 {
-	if(wayPriorityTablePtr->wayPriority[chNo].idleTail != WAY_NONE)
-	{
-		dieStateTablePtr->dieState[chNo][wayNo].prevWay = wayPriorityTablePtr->wayPriority[chNo].idleTail;
-		dieStateTablePtr->dieState[chNo][wayNo].nextWay = WAY_NONE;
-		dieStateTablePtr->dieState[chNo][wayPriorityTablePtr->wayPriority[chNo].idleTail].nextWay = wayNo;
-		wayPriorityTablePtr->wayPriority[chNo].idleTail = wayNo;
-	}
-	else
-	{
-		dieStateTablePtr->dieState[chNo][wayNo].prevWay =  WAY_NONE;
-		dieStateTablePtr->dieState[chNo][wayNo].nextWay =  WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].idleHead = wayNo;
-		wayPriorityTablePtr->wayPriority[chNo].idleTail = wayNo;
-	}
+	wayPriorityTablePtr->wayPriority[chNo].idleMask |= WAY_BIT(wayNo);
 }
 
-
 void SelectivGetFromNandIdleList(unsigned int chNo, unsigned int wayNo)
 {
-	if((dieStateTablePtr->dieState[chNo][wayNo].nextWay != WAY_NONE) && (dieStateTablePtr->dieState[chNo][wayNo].prevWay != WAY_NONE))
-	{
-		dieStateTablePtr->dieState[chNo][dieStateTablePtr->dieState[chNo][wayNo].prevWay].nextWay = dieStateTablePtr->dieState[chNo][wayNo].nextWay;
-		dieStateTablePtr->dieState[chNo][dieStateTablePtr->dieState[chNo][wayNo].nextWay].prevWay = dieStateTablePtr->dieState[chNo][wayNo].prevWay;
-	}
-	else if((dieStateTablePtr->dieState[chNo][wayNo].nextWay == WAY_NONE) && (dieStateTablePtr->dieState[chNo][wayNo].prevWay != WAY_NONE))
-	{
-		dieStateTablePtr->dieState[chNo][dieStateTablePtr->dieState[chNo][wayNo].prevWay].nextWay = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].idleTail = dieStateTablePtr->dieState[chNo][wayNo].prevWay;
-	}
-	else if((dieStateTablePtr->dieState[chNo][wayNo].nextWay != WAY_NONE) && (dieStateTablePtr->dieState[chNo][wayNo].prevWay == WAY_NONE))
-	{
-		dieStateTablePtr->dieState[chNo][dieStateTablePtr->dieState[chNo][wayNo].nextWay].prevWay = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].idleHead = dieStateTablePtr->dieState[chNo][wayNo].nextWay;
-	}
-	else
-	{
-		wayPriorityTablePtr->wayPriority[chNo].idleHead = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].idleTail = WAY_NONE;
-	}
+	wayPriorityTablePtr->wayPriority[chNo].idleMask &= ~WAY_BIT(wayNo);
 }
 
-
-
 void PutToNandStatusReportList(unsigned int chNo, unsigned int wayNo)
 {
-	if(wayPriorityTablePtr->wayPriority[chNo].statusReportTail != WAY_NONE)
-	{
-		dieStateTablePtr->dieState[chNo][wayNo].prevWay = wayPriorityTablePtr->wayPriority[chNo].statusReportTail;
-		dieStateTablePtr->dieState[chNo][wayNo].nextWay = WAY_NONE;
-		dieStateTablePtr->dieState[chNo][wayPriorityTablePtr->wayPriority[chNo].statusReportTail].nextWay = wayNo;
-		wayPriorityTablePtr->wayPriority[chNo].statusReportTail = wayNo;
-	}
-	else
-	{
-		dieStateTablePtr->dieState[chNo][wayNo].prevWay =  WAY_NONE;
-		dieStateTablePtr->dieState[chNo][wayNo].nextWay =  WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].statusReportHead = wayNo;
-		wayPriorityTablePtr->wayPriority[chNo].statusReportTail = wayNo;
-	}
+	wayPriorityTablePtr->wayPriority[chNo].statusReportMask |= WAY_BIT(wayNo);
 }
 
 void SelectivGetFromNandStatusReportList(unsigned int chNo, unsigned int wayNo)
 {
-	if((dieStateTablePtr->dieState[chNo][wayNo].nextWay != WAY_NONE) && (dieStateTablePtr->dieState[chNo][wayNo].prevWay != WAY_NONE))
-	{
-		dieStateTablePtr->dieState[chNo][dieStateTablePtr->dieState[chNo][wayNo].prevWay].nextWay = dieStateTablePtr->dieState[chNo][wayNo].nextWay;
-		dieStateTablePtr->dieState[chNo][dieStateTablePtr->dieState[chNo][wayNo].nextWay].prevWay = dieStateTablePtr->dieState[chNo][wayNo].prevWay;
-	}
-	else if((dieStateTablePtr->dieState[chNo][wayNo].nextWay == WAY_NONE) && (dieStateTablePtr->dieState[chNo][wayNo].prevWay != WAY_NONE))
-	{
-		dieStateTablePtr->dieState[chNo][dieStateTablePtr->dieState[chNo][wayNo].prevWay].nextWay = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].statusReportTail = dieStateTablePtr->dieState[chNo][wayNo].prevWay;
-	}
-	else if((dieStateTablePtr->dieState[chNo][wayNo].nextWay != WAY_NONE) && (dieStateTablePtr->dieState[chNo][wayNo].prevWay == WAY_NONE))
-	{
-		dieStateTablePtr->dieState[chNo][dieStateTablePtr->dieState[chNo][wayNo].nextWay].prevWay = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].statusReportHead = dieStateTablePtr->dieState[chNo][wayNo].nextWay;
-	}
-	else
-	{
-		wayPriorityTablePtr->wayPriority[chNo].statusReportHead = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].statusReportTail = WAY_NONE;
-	}
+	wayPriorityTablePtr->wayPriority[chNo].statusReportMask &= ~WAY_BIT(wayNo);
 }
 
-
 void PutToNandReadTriggerList(unsigned int chNo, unsigned int wayNo)
 {
-	if(wayPriorityTablePtr->wayPriority[chNo].readTriggerTail != WAY_NONE)
-	{
-		dieStateTablePtr->dieState[chNo][wayNo].prevWay = wayPriorityTablePtr->wayPriority[chNo].readTriggerTail;
-		dieStateTablePtr->dieState[chNo][wayNo].nextWay = WAY_NONE;
-		dieStateTablePtr->dieState[chNo][wayPriorityTablePtr->wayPriority[chNo].readTriggerTail].nextWay = wayNo;
-		wayPriorityTablePtr->wayPriority[chNo].readTriggerTail = wayNo;
-	}
-	else
-	{
-		dieStateTablePtr->dieState[chNo][wayNo].prevWay =  WAY_NONE;
-		dieStateTablePtr->dieState[chNo][wayNo].nextWay =  WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].readTriggerHead = wayNo;
-		wayPriorityTablePtr->wayPriority[chNo].readTriggerTail = wayNo;
-	}
+	wayPriorityTablePtr->wayPriority[chNo].readTriggerMask |= WAY_BIT(wayNo);
 }
 
 void SelectiveGetFromNandReadTriggerList(unsigned int chNo, unsigned int wayNo)
 {
-	if((dieStateTablePtr->dieState[chNo][wayNo].nextWay != WAY_NONE) && (dieStateTablePtr->dieState[chNo][wayNo].prevWay != WAY_NONE))
-	{
-		dieStateTablePtr->dieState[chNo][dieStateTablePtr->dieState[chNo][wayNo].prevWay].nextWay = dieStateTablePtr->dieState[chNo][wayNo].nextWay;
-		dieStateTablePtr->dieState[chNo][dieStateTablePtr->dieState[chNo][wayNo].nextWay].prevWay = dieStateTablePtr->dieState[chNo][wayNo].prevWay;
-	}
-	else if((dieStateTablePtr->dieState[chNo][wayNo].nextWay == WAY_NONE) && (dieStateTablePtr->dieState[chNo][wayNo].prevWay != WAY_NONE))
-	{
-		dieStateTablePtr->dieState[chNo][dieStateTablePtr->dieState[chNo][wayNo].prevWay].nextWay = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].readTriggerTail = dieStateTablePtr->dieState[chNo][wayNo].prevWay;
-	}
-	else if((dieStateTablePtr->dieState[chNo][wayNo].nextWay != WAY_NONE) && (dieStateTablePtr->dieState[chNo][wayNo].prevWay == WAY_NONE))
-	{
-		dieStateTablePtr->dieState[chNo][dieStateTablePtr->dieState[chNo][wayNo].nextWay].prevWay = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].readTriggerHead = dieStateTablePtr->dieState[chNo][wayNo].nextWay;
-	}
-	else
-	{
-		wayPriorityTablePtr->wayPriority[chNo].readTriggerHead = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].readTriggerTail = WAY_NONE;
-	}
+	wayPriorityTablePtr->wayPriority[chNo].readTriggerMask &= ~WAY_BIT(wayNo);
 }
 
 void PutToNandWriteList(unsigned int chNo, unsigned int wayNo)
 {
-	if(wayPriorityTablePtr->wayPriority[chNo].writeTail != WAY_NONE)
-	{
-		dieStateTablePtr->dieState[chNo][wayNo].prevWay = wayPriorityTablePtr->wayPriority[chNo].writeTail;
-		dieStateTablePtr->dieState[chNo][wayNo].nextWay = WAY_NONE;
-		dieStateTablePtr->dieState[chNo][wayPriorityTablePtr->wayPriority[chNo].writeTail].nextWay = wayNo;
-		wayPriorityTablePtr->wayPriority[chNo].writeTail = wayNo;
-	}
-	else
-	{
-		dieStateTablePtr->dieState[chNo][wayNo].prevWay =  WAY_NONE;
-		dieStateTablePtr->dieState[chNo][wayNo].nextWay =  WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].writeHead = wayNo;
-		wayPriorityTablePtr->wayPriority[chNo].writeTail = wayNo;
-	}
+	wayPriorityTablePtr->wayPriority[chNo].writeMask |= WAY_BIT(wayNo);
 }
 
 void SelectiveGetFromNandWriteList(unsigned int chNo, unsigned int wayNo)
 {
-	if((dieStateTablePtr->dieState[chNo][wayNo].nextWay != WAY_NONE) && (dieStateTablePtr->dieState[chNo][wayNo].prevWay != WAY_NONE))
-	{
-		dieStateTablePtr->dieState[chNo][dieStateTablePtr->dieState[chNo][wayNo].prevWay].nextWay = dieStateTablePtr->dieState[chNo][wayNo].nextWay;
-		dieStateTablePtr->dieState[chNo][dieStateTablePtr->dieState[chNo][wayNo].nextWay].prevWay = dieStateTablePtr->dieState[chNo][wayNo].prevWay;
-	}
-	else if((dieStateTablePtr->dieState[chNo][wayNo].nextWay == WAY_NONE) && (dieStateTablePtr->dieState[chNo][wayNo].prevWay != WAY_NONE))
-	{
-		dieStateTablePtr->dieState[chNo][dieStateTablePtr->dieState[chNo][wayNo].prevWay].nextWay = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].writeTail = dieStateTablePtr->dieState[chNo][wayNo].prevWay;
-	}
-	else if((dieStateTablePtr->dieState[chNo][wayNo].nextWay != WAY_NONE) && (dieStateTablePtr->dieState[chNo][wayNo].prevWay == WAY_NONE))
-	{
-		dieStateTablePtr->dieState[chNo][dieStateTablePtr->dieState[chNo][wayNo].nextWay].prevWay = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].writeHead = dieStateTablePtr->dieState[chNo][wayNo].nextWay;
-	}
-	else
-	{
-		wayPriorityTablePtr->wayPriority[chNo].writeHead = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].writeTail = WAY_NONE;
-	}
-
+	wayPriorityTablePtr->wayPriority[chNo].writeMask &= ~WAY_BIT(wayNo);
 }
 
 void PutToNandReadTransferList(unsigned int chNo, unsigned int wayNo)
 {
-	if(wayPriorityTablePtr->wayPriority[chNo].readTransferTail != WAY_NONE)
-	{
-		dieStateTablePtr->dieState[chNo][wayNo].prevWay = wayPriorityTablePtr->wayPriority[chNo].readTransferTail;
-		dieStateTablePtr->dieState[chNo][wayNo].nextWay = WAY_NONE;
-		dieStateTablePtr->dieState[chNo][wayPriorityTablePtr->wayPriority[chNo].readTransferTail].nextWay = wayNo;
-		wayPriorityTablePtr->wayPriority[chNo].readTransferTail = wayNo;
-	}
-	else
-	{
-		dieStateTablePtr->dieState[chNo][wayNo].prevWay =  WAY_NONE;
-		dieStateTablePtr->dieState[chNo][wayNo].nextWay =  WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].readTransferHead = wayNo;
-		wayPriorityTablePtr->wayPriority[chNo].readTransferTail = wayNo;
-	}
+	wayPriorityTablePtr->wayPriority[chNo].readTransferMask |= WAY_BIT(wayNo);
 }
 
 void SelectiveGetFromNandReadTransferList(unsigned int chNo, unsigned int wayNo)
 {
-	if((dieStateTablePtr->dieState[chNo][wayNo].nextWay != WAY_NONE) && (dieStateTablePtr->dieState[chNo][wayNo].prevWay != WAY_NONE))
-	{
-		dieStateTablePtr->dieState[chNo][dieStateTablePtr->dieState[chNo][wayNo].prevWay].nextWay = dieStateTablePtr->dieState[chNo][wayNo].nextWay;
-		dieStateTablePtr->dieState[chNo][dieStateTablePtr->dieState[chNo][wayNo].nextWay].prevWay = dieStateTablePtr->dieState[chNo][wayNo].prevWay;
-	}
-	else if((dieStateTablePtr->dieState[chNo][wayNo].nextWay == WAY_NONE) && (dieStateTablePtr->dieState[chNo][wayNo].prevWay != WAY_NONE))
-	{
-		dieStateTablePtr->dieState[chNo][dieStateTablePtr->dieState[chNo][wayNo].prevWay].nextWay = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].readTransferTail = dieStateTablePtr->dieState[chNo][wayNo].prevWay;
-	}
-	else if((dieStateTablePtr->dieState[chNo][wayNo].nextWay != WAY_NONE) && (dieStateTablePtr->dieState[chNo][wayNo].prevWay == WAY_NONE))
-	{
-		dieStateTablePtr->dieState[chNo][dieStateTablePtr->dieState[chNo][wayNo].nextWay].prevWay = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].readTransferHead = dieStateTablePtr->dieState[chNo][wayNo].nextWay;
-	}
-	else
-	{
-		wayPriorityTablePtr->wayPriority[chNo].readTransferHead = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].readTransferTail = WAY_NONE;
-	}
+	wayPriorityTablePtr->wayPriority[chNo].readTransferMask &= ~WAY_BIT(wayNo);
 }
 
-
 void PutToNandEraseList(unsigned int chNo, unsigned int wayNo)
 {
-	if(wayPriorityTablePtr->wayPriority[chNo].eraseTail != WAY_NONE)
-	{
-		dieStateTablePtr->dieState[chNo][wayNo].prevWay = wayPriorityTablePtr->wayPriority[chNo].eraseTail;
-		dieStateTablePtr->dieState[chNo][wayNo].nextWay = WAY_NONE;
-		dieStateTablePtr->dieState[chNo][wayPriorityTablePtr->wayPriority[chNo].eraseTail].nextWay = wayNo;
-		wayPriorityTablePtr->wayPriority[chNo].eraseTail = wayNo;
-	}
-	else
-	{
-		dieStateTablePtr->dieState[chNo][wayNo].prevWay =  WAY_NONE;
-		dieStateTablePtr->dieState[chNo][wayNo].nextWay =  WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].eraseHead = wayNo;
-		wayPriorityTablePtr->wayPriority[chNo].eraseTail = wayNo;
-	}
+	wayPriorityTablePtr->wayPriority[chNo].eraseMask |= WAY_BIT(wayNo);
 }
 
-
 void SelectiveGetFromNandEraseList(unsigned int chNo, unsigned int wayNo)
 {
-	if((dieStateTablePtr->dieState[chNo][wayNo].nextWay != WAY_NONE) && (dieStateTablePtr->dieState[chNo][wayNo].prevWay != WAY_NONE))
-	{
-		dieStateTablePtr->dieState[chNo][dieStateTablePtr->dieState[chNo][wayNo].prevWay].nextWay = dieStateTablePtr->dieState[chNo][wayNo].nextWay;
-		dieStateTablePtr->dieState[chNo][dieStateTablePtr->dieState[chNo][wayNo].nextWay].prevWay = dieStateTablePtr->dieState[chNo][wayNo].prevWay;
-	}
-	else if((dieStateTablePtr->dieState[chNo][wayNo].nextWay == WAY_NONE) && (dieStateTablePtr->dieState[chNo][wayNo].prevWay != WAY_NONE))
-	{
-		dieStateTablePtr->dieState[chNo][dieStateTablePtr->dieState[chNo][wayNo].prevWay].nextWay = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].eraseTail = dieStateTablePtr->dieState[chNo][wayNo].prevWay;
-	}
-	else if((dieStateTablePtr->dieState[chNo][wayNo].nextWay != WAY_NONE) && (dieStateTablePtr->dieState[chNo][wayNo].prevWay == WAY_NONE))
-	{
-		dieStateTablePtr->dieState[chNo][dieStateTablePtr->dieState[chNo][wayNo].nextWay].prevWay = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].eraseHead = dieStateTablePtr->dieState[chNo][wayNo].nextWay;
-	}
-	else
-	{
-		wayPriorityTablePtr->wayPriority[chNo].eraseHead = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].eraseTail = WAY_NONE;
-	}
+	wayPriorityTablePtr->wayPriority[chNo].eraseMask &= ~WAY_BIT(wayNo);
 }
 
 void PutToNandStatusCheckList(unsigned int chNo, unsigned int wayNo)
 {
-	if(wayPriorityTablePtr->wayPriority[chNo].statusCheckTail != WAY_NONE)
-	{
-		dieStateTablePtr->dieState[chNo][wayNo].prevWay = wayPriorityTablePtr->wayPriority[chNo].statusCheckTail;
-		dieStateTablePtr->dieState[chNo][wayNo].nextWay = WAY_NONE;
-		dieStateTablePtr->dieState[chNo][wayPriorityTablePtr->wayPriority[chNo].statusCheckTail].nextWay = wayNo;
-		wayPriorityTablePtr->wayPriority[chNo].statusCheckTail = wayNo;
-	}
-	else
-	{
-		dieStateTablePtr->dieState[chNo][wayNo].prevWay =  WAY_NONE;
-		dieStateTablePtr->dieState[chNo][wayNo].nextWay =  WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].statusCheckHead = wayNo;
-		wayPriorityTablePtr->wayPriority[chNo].statusCheckTail = wayNo;
-	}
+	wayPriorityTablePtr->wayPriority[chNo].statusCheckMask |= WAY_BIT(wayNo);
 }
 
 void SelectiveGetFromNandStatusCheckList(unsigned int chNo, unsigned int wayNo)
 {
-	if((dieStateTablePtr->dieState[chNo][wayNo].nextWay != WAY_NONE) && (dieStateTablePtr->dieState[chNo][wayNo].prevWay != WAY_NONE))
-	{
-		dieStateTablePtr->dieState[chNo][dieStateTablePtr->dieState[chNo][wayNo].prevWay].nextWay = dieStateTablePtr->dieState[chNo][wayNo].nextWay;
-		dieStateTablePtr->dieState[chNo][dieStateTablePtr->dieState[chNo][wayNo].nextWay].prevWay = dieStateTablePtr->dieState[chNo][wayNo].prevWay;
-	}
-	else if((dieStateTablePtr->dieState[chNo][wayNo].nextWay == WAY_NONE) && (dieStateTablePtr->dieState[chNo][wayNo].prevWay != WAY_NONE))
-	{
-		dieStateTablePtr->dieState[chNo][dieStateTablePtr->dieState[chNo][wayNo].prevWay].nextWay = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].statusCheckTail = dieStateTablePtr->dieState[chNo][wayNo].prevWay;
-	}
-	else if((dieStateTablePtr->dieState[chNo][wayNo].nextWay != WAY_NONE) && (dieStateTablePtr->dieState[chNo][wayNo].prevWay == WAY_NONE))
-	{
-		dieStateTablePtr->dieState[chNo][dieStateTablePtr->dieState[chNo][wayNo].nextWay].prevWay = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].statusCheckHead = dieStateTablePtr->dieState[chNo][wayNo].nextWay;
-	}
-	else
-	{
-		wayPriorityTablePtr->wayPriority[chNo].statusCheckHead = WAY_NONE;
-		wayPriorityTablePtr->wayPriority[chNo].statusCheckTail = WAY_NONE;
-	}
-
+	wayPriorityTablePtr->wayPriority[chNo].statusCheckMask &= ~WAY_BIT(wayNo);
 }
 
 unsigned char modeTable[] = { 0x17, 0x37, 0x17, 0x17 };
@@ -760,6 +570,10 @@ unsigned int GenerateDataBufAddr(unsigned int reqSlotTag)
 			return (TEMPORARY_DATA_BUFFER_BASE_ADDR + reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry * BYTES_PER_DATA_REGION_OF_SLICE);
 		else if(reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat == REQ_OPT_DATA_BUF_ADDR)
 			return reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.addr;
+		else if(reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat == REQ_OPT_DATA_BUF_BYPASS_ENTRY)
+			return (BYPASS_DATA_BUFFER_BASE_ADDR + reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry * BYTES_PER_DATA_REGION_OF_SLICE);
+		else if(reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat == REQ_OPT_DATA_BUF_MERGE_ENTRY)
+			return (BYPASS_DATA_BUFFER_BASE_ADDR + dataBufMapPtr->dataBuf[reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry].mergeEntry * BYTES_PER_DATA_REGION_OF_SLICE);
 
 		return RESERVED_DATA_BUFFER_BASE_ADDR;
 	}
@@ -767,6 +581,8 @@ unsigned int GenerateDataBufAddr(unsigned int reqSlotTag)
 	{
 		if(reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat == REQ_OPT_DATA_BUF_ENTRY)
 			return (DATA_BUFFER_BASE_ADDR + reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry * BYTES_PER_DATA_REGION_OF_SLICE + reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.nvmeBlockOffset * BYTES_PER_NVME_BLOCK);
+		else if(reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat == REQ_OPT_DATA_BUF_BYPASS_ENTRY)
+			return (BYPASS_DATA_BUFFER_BASE_ADDR + reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry * BYTES_PER_DATA_REGION_OF_SLICE + reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.nvmeBlockOffset * BYTES_PER_NVME_BLOCK);
 		else
 			assert(!"[WARNING] wrong reqOpt-dataBufFormat [WARNING]");
 	}
@@ -785,6 +601,10 @@ unsigned int GenerateSpareDataBufAddr(unsigned int reqSlotTag)
 			return (TEMPORARY_SPARE_DATA_BUFFER_BASE_ADDR + reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry * BYTES_PER_SPARE_REGION_OF_SLICE);
 		else if(reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat == REQ_OPT_DATA_BUF_ADDR)
 			return (reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.addr + BYTES_PER_DATA_REGION_OF_SLICE); // modify PAGE_SIZE to other
+		else if(reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat == REQ_OPT_DATA_BUF_BYPASS_ENTRY)
+			return (BYPASS_SPARE_DATA_BUFFER_BASE_ADDR + reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry * BYTES_PER_SPARE_REGION_OF_SLICE);
+		else if(reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat == REQ_OPT_DATA_BUF_MERGE_ENTRY)
+			return (BYPASS_SPARE_DATA_BUFFER_BASE_ADDR + dataBufMapPtr->dataBuf[reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry].mergeEntry * BYTES_PER_SPARE_REGION_OF_SLICE);
 
 		return (RESERVED_DATA_BUFFER_BASE_ADDR + BYTES_PER_DATA_REGION_OF_SLICE);
 	}
@@ -792,6 +612,8 @@ unsigned int GenerateSpareDataBufAddr(unsigned int reqSlotTag)
 	{
 		if(reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat == REQ_OPT_DATA_BUF_ENTRY)
 			return (SPARE_DATA_BUFFER_BASE_ADDR + reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry * BYTES_PER_SPARE_REGION_OF_SLICE);
+		else if(reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat == REQ_OPT_DATA_BUF_BYPASS_ENTRY)
+			return (BYPASS_SPARE_DATA_BUFFER_BASE_ADDR + reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry * BYTES_PER_SPARE_REGION_OF_SLICE);
 		else
 			assert(!"[WARNING] wrong reqOpt-dataBufFormat [WARNING]");
 	}
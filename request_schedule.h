@@ -52,6 +52,9 @@
 
 #define WAY_NONE 			0xF
 
+//each way list of WAY_PRIORITY_ENTRY is a bit set indexed by way number (USER_WAYS <= 8)
+#define WAY_BIT(wayNo)		(1 << (wayNo))
+
 #define LUN_0_BASE_ADDR		0x00000000
 #define LUN_1_BASE_ADDR		0x00100000
 
@@ -96,9 +99,7 @@ typedef struct _RETRY_LIMIT_TABLE {
 typedef struct _DIE_STATE_ENTRY {
 	unsigned int dieState	:	8;
 	unsigned int reqStatusCheckOpt	:	4;
-	unsigned int prevWay	:	4;
-	unsigned int nextWay 	:	4;
-	unsigned int reserved	:	12;
+	unsigned int reserved	:	20;
 } DIE_STATE_ENTRY, *P_DIE_STATE_ENTRY;
 
 typedef struct _DIE_STATE_TABLE {
@@ -107,21 +108,15 @@ typedef struct _DIE_STATE_TABLE {
 
 
 typedef struct _WAY_PRIORITY_ENTRY {
-	unsigned int idleHead :	4;
-	unsigned int idleTail :	4;
-	unsigned int statusReportHead	:	4;
-	unsigned int statusReportTail 	:	4;
-	unsigned int readTriggerHead	:	4;
-	unsigned int readTriggerTail	:	4;
-	unsigned int writeHead	:	4;
-	unsigned int writeTail	:	4;
-	unsigned int readTransferHead	:	4;
-	unsigned int readTransferTail	:	4;
-	unsigned int eraseHead	:	4;
-	unsigned int eraseTail	:	4;
-	unsigned int statusCheckHead	:	4;
-	unsigned int statusCheckTail	:	4;
-	unsigned int reserved : 8;
+	unsigned int idleMask :	8;
+	unsigned int statusReportMask	:	8;
+	unsigned int readTriggerMask	:	8;
+	unsigned int writeMask	:	8;
+	unsigned int readTransferMask	:	8;
+	unsigned int eraseMask	:	8;
+	unsigned int statusCheckMask	:	8;
+	unsigned int issueStartWay	:	4;
+	unsigned int reserved : 4;
 } WAY_PRIORITY_ENTRY, *P_WAY_PRIORITY_ENTRY;
 
 typedef struct _WAY_PRIORITY_TABLE {
@@ -133,7 +128,8 @@ void InitReqScheduler();
 
 void SyncAllLowLevelReqDone();
 void SyncAvailFreeReq();
-void SyncReleaseEraseReq(unsigned int chNo, unsigned int wayNo, unsigned int blockNo);
+void SyncAvailBypassDataBuf();
+void SyncMergedDataBufEntry(unsigned int dataBufEntry);
 void SchedulingNandReq();
 void SchedulingNandReqPerCh(unsigned int chNo);
 
@@ -153,6 +149,9 @@ void SelectiveGetFromNandEraseList(unsigned int chNo, unsigned int wayNo);
 void PutToNandStatusCheckList(unsigned int chNo, unsigned int wayNo);
 void SelectiveGetFromNandStatusCheckList(unsigned int chNo, unsigned int wayNo);
 
+unsigned int SelectWayFromMask(unsigned int wayMask, unsigned int startWay);
+unsigned int SelectIssueWay(unsigned int chNo, unsigned int wayMask);
+
 void IssueNandReq(unsigned int chNo, unsigned int wayNo);
 unsigned int GenerateNandRowAddr(unsigned int reqSlotTag);
 unsigned int GenerateDataBufAddr(unsigned int reqSlotTag);
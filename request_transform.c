@@ -48,11 +48,19 @@
 
 #include "xil_printf.h"
 #include <assert.h>
+#include <stdint.h>
+#include <string.h>
 #include "nvme/nvme.h"
 #include "nvme/host_lld.h"
 #include "memory_map.h"
 #include "ftl_config.h"
 
+#ifdef NVME_DMA_DONE_PROFILE
+#include "xtime_l.h"
+
+#define NVME_DMA_DONE_PROFILE_COUNT	1000000
+#endif
+
 P_ROW_ADDR_DEPENDENCY_TABLE rowAddrDependencyTablePtr;
 
 void InitDependencyTable()
@@ -74,9 +82,9 @@ void InitDependencyTable()
 	}
 }
 
-void ReqTransNvmeToSlice(unsigned int cmdSlotTag, unsigned int startLba, unsigned int nlb, unsigned int cmdCode)
+void ReqTransNvmeToSlice(unsigned int cmdSlotTag, unsigned int startLba, unsigned int nlb, unsigned int cmdCode, unsigned int ioClass)
 {
-	unsigned int reqSlotTag, requestedNvmeBlock, tempNumOfNvmeBlock, transCounter, tempLsa, loop, nvmeBlockOffset, nvmeDmaStartIndex, reqCode;
+	unsigned int reqSlotTag, requestedNvmeBlock, tempNumOfNvmeBlock, transCounter, tempLsa, loop, nvmeBlockOffset, nvmeDmaStartIndex, reqCode, dataBufFormat;
 
 	requestedNvmeBlock = nlb + 1;
 	transCounter = 0;
@@ -95,6 +103,12 @@ void ReqTransNvmeToSlice(unsigned int cmdSlotTag, unsigned int startLba, unsigne
 	else
 		assert(!"[WARNING] Not supported command code [WARNING]");
 
+	// slices of a large read are marked to stream through the bypass ring, the format is fixed when the slice is transformed
+	if ((reqCode == REQ_CODE_READ) && (requestedNvmeBlock >= BYPASS_READ_MIN_NVME_BLOCKS))
+		dataBufFormat = REQ_OPT_DATA_BUF_BYPASS_ENTRY;
+	else
+		dataBufFormat = REQ_OPT_DATA_BUF_ENTRY;
+
 	// first transform
 	nvmeBlockOffset = (startLba % NVME_BLOCKS_PER_SLICE);
 	if (loop)
@@ -110,6 +124,8 @@ void ReqTransNvmeToSlice(unsigned int cmdSlotTag, unsigned int startLba, unsigne
 	reqPoolPtr->reqPool[reqSlotTag].reqCode = reqCode;
 	reqPoolPtr->reqPool[reqSlotTag].nvmeCmdSlotTag = cmdSlotTag;
 	reqPoolPtr->reqPool[reqSlotTag].logicalSliceAddr = tempLsa;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat = dataBufFormat;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.ioClass = ioClass;
 	reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.startIndex = nvmeDmaStartIndex;
 	reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.nvmeBlockOffset = nvmeBlockOffset;
 	reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.numOfNvmeBlock = tempNumOfNvmeBlock;
@@ -132,6 +148,8 @@ void ReqTransNvmeToSlice(unsigned int cmdSlotTag, unsigned int startLba, unsigne
 		reqPoolPtr->reqPool[reqSlotTag].reqCode = reqCode;
 		reqPoolPtr->reqPool[reqSlotTag].nvmeCmdSlotTag = cmdSlotTag;
 		reqPoolPtr->reqPool[reqSlotTag].logicalSliceAddr = tempLsa;
+		reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat = dataBufFormat;
+		reqPoolPtr->reqPool[reqSlotTag].reqOpt.ioClass = ioClass;
 		reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.startIndex = nvmeDmaStartIndex;
 		reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.nvmeBlockOffset = nvmeBlockOffset;
 		reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.numOfNvmeBlock = tempNumOfNvmeBlock;
@@ -155,6 +173,8 @@ void ReqTransNvmeToSlice(unsigned int cmdSlotTag, unsigned int startLba, unsigne
 	reqPoolPtr->reqPool[reqSlotTag].reqCode = reqCode;
 	reqPoolPtr->reqPool[reqSlotTag].nvmeCmdSlotTag = cmdSlotTag;
 	reqPoolPtr->reqPool[reqSlotTag].logicalSliceAddr = tempLsa;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat = dataBufFormat;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.ioClass = ioClass;
 	reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.startIndex = nvmeDmaStartIndex;
 	reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.nvmeBlockOffset = nvmeBlockOffset;
 	reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.numOfNvmeBlock = tempNumOfNvmeBlock;
@@ -162,72 +182,277 @@ void ReqTransNvmeToSlice(unsigned int cmdSlotTag, unsigned int startLba, unsigne
 	PutToSliceReqQ(reqSlotTag);
 }
 
+// reads the blocks a partial write left out into the merge buffer, they are copied into the entry when the read completes
+void MergeDataBufEntryFromNand(unsigned int dataBufEntry, unsigned int ioClass)
+{
+	unsigned int reqSlotTag, virtualSliceAddr, mergeEntry;
+
+	if (dataBufMapPtr->dataBuf[dataBufEntry].validMask == DATA_BUF_VALID_ALL)
+		return;
+
+	// must be translated before a write back of this slice moves the mapping
+	virtualSliceAddr = AddrTransRead(dataBufMapPtr->dataBuf[dataBufEntry].logicalSliceAddr);
+	if (virtualSliceAddr == VSA_FAIL)
+	{
+		dataBufMapPtr->dataBuf[dataBufEntry].validMask = DATA_BUF_VALID_ALL;
+		return;
+	}
+
+	// a merge issued for the previous owner of the entry may still be in flight
+	SyncMergedDataBufEntry(dataBufEntry);
+
+	mergeEntry = AllocateBypassDataBuf();
+	if (mergeEntry == DATA_BUF_FAIL)
+	{
+		SyncAvailBypassDataBuf();
+		mergeEntry = AllocateBypassDataBuf();
+	}
+
+	reqSlotTag = GetFromFreeReqQ();
+
+	reqPoolPtr->reqPool[reqSlotTag].reqType = REQ_TYPE_NAND;
+	reqPoolPtr->reqPool[reqSlotTag].reqCode = REQ_CODE_READ;
+	reqPoolPtr->reqPool[reqSlotTag].logicalSliceAddr = dataBufMapPtr->dataBuf[dataBufEntry].logicalSliceAddr;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat = REQ_OPT_DATA_BUF_MERGE_ENTRY;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandAddr = REQ_OPT_NAND_ADDR_VSA;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandEcc = REQ_OPT_NAND_ECC_ON;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandEccWarning = REQ_OPT_NAND_ECC_WARNING_ON;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.rowAddrDependencyCheck = REQ_OPT_ROW_ADDR_DEPENDENCY_CHECK;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.blockSpace = REQ_OPT_BLOCK_SPACE_MAIN;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.ioClass = ioClass;
+	reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry = dataBufEntry;
+	reqPoolPtr->reqPool[reqSlotTag].nandInfo.virtualSliceAddr = virtualSliceAddr;
+
+	// the merge buffer stays busy until the read completes, later requests on the entry wait behind the read
+	bypassDataBufMapPtr->bypassDataBuf[mergeEntry].blockingReqTail = reqSlotTag;
+	dataBufMapPtr->dataBuf[dataBufEntry].mergeEntry = mergeEntry;
+	dataBufMapPtr->dataBuf[dataBufEntry].mergeMask = DATA_BUF_VALID_ALL & ~dataBufMapPtr->dataBuf[dataBufEntry].validMask;
+	dataBufMapPtr->dataBuf[dataBufEntry].validMask = DATA_BUF_VALID_ALL;
+	UpdateDataBufEntryInfoBlockingReq(dataBufEntry, reqSlotTag);
+
+	SelectLowLevelReqQ(reqSlotTag);
+	dataBufMergeReadCnt++;
+}
+
+// called when a merge read completes, before the requests waiting on the entry are released
+void CopyMergedDataBufEntry(unsigned int reqSlotTag)
+{
+	unsigned int dataBufEntry, nvmeBlock, mergeMask, srcAddr, dstAddr;
+
+	dataBufEntry = reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry;
+	mergeMask = dataBufMapPtr->dataBuf[dataBufEntry].mergeMask;
+
+	for (nvmeBlock = 0; nvmeBlock < NVME_BLOCKS_PER_SLICE; nvmeBlock++)
+		if (mergeMask & (1 << nvmeBlock))
+		{
+			srcAddr = BYPASS_DATA_BUFFER_BASE_ADDR + dataBufMapPtr->dataBuf[dataBufEntry].mergeEntry * BYTES_PER_DATA_REGION_OF_SLICE + nvmeBlock * BYTES_PER_NVME_BLOCK;
+			dstAddr = DATA_BUFFER_BASE_ADDR + dataBufEntry * BYTES_PER_DATA_REGION_OF_SLICE + nvmeBlock * BYTES_PER_NVME_BLOCK;
+
+			memcpy((void *)(uintptr_t)dstAddr, (void *)(uintptr_t)srcAddr, BYTES_PER_NVME_BLOCK);
+		}
+
+	dataBufMapPtr->dataBuf[dataBufEntry].mergeMask = 0;
+}
+
+void WriteBackDataBufEntry(unsigned int dataBufEntry, unsigned int ioClass)
+{
+	unsigned int reqSlotTag, virtualSliceAddr;
+
+	MergeDataBufEntryFromNand(dataBufEntry, ioClass);
+
+	reqSlotTag = GetFromFreeReqQ();
+	virtualSliceAddr = AddrTransWrite(dataBufMapPtr->dataBuf[dataBufEntry].logicalSliceAddr);
+
+	reqPoolPtr->reqPool[reqSlotTag].reqType = REQ_TYPE_NAND;
+	reqPoolPtr->reqPool[reqSlotTag].reqCode = REQ_CODE_WRITE;
+	reqPoolPtr->reqPool[reqSlotTag].logicalSliceAddr = dataBufMapPtr->dataBuf[dataBufEntry].logicalSliceAddr;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat = REQ_OPT_DATA_BUF_ENTRY;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandAddr = REQ_OPT_NAND_ADDR_VSA;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandEcc = REQ_OPT_NAND_ECC_ON;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandEccWarning = REQ_OPT_NAND_ECC_WARNING_ON;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.rowAddrDependencyCheck = REQ_OPT_ROW_ADDR_DEPENDENCY_CHECK;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.blockSpace = REQ_OPT_BLOCK_SPACE_MAIN;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.ioClass = ioClass;
+	reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry = dataBufEntry;
+	UpdateDataBufEntryInfoBlockingReq(dataBufEntry, reqSlotTag);
+	reqPoolPtr->reqPool[reqSlotTag].nandInfo.virtualSliceAddr = virtualSliceAddr;
+
+	SelectLowLevelReqQ(reqSlotTag);
+
+	dataBufMapPtr->dataBuf[dataBufEntry].dirty = DATA_BUF_CLEAN;
+	dirtyDataBufCnt--;
+}
+
 void EvictDataBufEntry(unsigned int originReqSlotTag)
 {
-	unsigned int reqSlotTag, virtualSliceAddr, dataBufEntry;
+	unsigned int dataBufEntry;
 
 	dataBufEntry = reqPoolPtr->reqPool[originReqSlotTag].dataBufInfo.entry;
 	if (dataBufMapPtr->dataBuf[dataBufEntry].dirty == DATA_BUF_DIRTY)
-	{
-		reqSlotTag = GetFromFreeReqQ();
-		virtualSliceAddr = AddrTransWrite(dataBufMapPtr->dataBuf[dataBufEntry].logicalSliceAddr);
+		WriteBackDataBufEntry(dataBufEntry, reqPoolPtr->reqPool[originReqSlotTag].reqOpt.ioClass);
+}
 
-		reqPoolPtr->reqPool[reqSlotTag].reqType = REQ_TYPE_NAND;
-		reqPoolPtr->reqPool[reqSlotTag].reqCode = REQ_CODE_WRITE;
-		reqPoolPtr->reqPool[reqSlotTag].nvmeCmdSlotTag = reqPoolPtr->reqPool[originReqSlotTag].nvmeCmdSlotTag;
-		reqPoolPtr->reqPool[reqSlotTag].logicalSliceAddr = dataBufMapPtr->dataBuf[dataBufEntry].logicalSliceAddr;
-		reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat = REQ_OPT_DATA_BUF_ENTRY;
-		reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandAddr = REQ_OPT_NAND_ADDR_VSA;
-		reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandEcc = REQ_OPT_NAND_ECC_ON;
-		reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandEccWarning = REQ_OPT_NAND_ECC_WARNING_ON;
-		reqPoolPtr->reqPool[reqSlotTag].reqOpt.rowAddrDependencyCheck = REQ_OPT_ROW_ADDR_DEPENDENCY_CHECK;
-		reqPoolPtr->reqPool[reqSlotTag].reqOpt.blockSpace = REQ_OPT_BLOCK_SPACE_MAIN;
-		reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry = dataBufEntry;
-		UpdateDataBufEntryInfoBlockingReq(dataBufEntry, reqSlotTag);
-		reqPoolPtr->reqPool[reqSlotTag].nandInfo.virtualSliceAddr = virtualSliceAddr;
+// writes back dirty entries near the list tails ahead of their eviction, called while dies are idle
+void DestageDataBuf()
+{
+	unsigned int dataBufEntry, listNo, scanCnt;
 
-		SelectLowLevelReqQ(reqSlotTag);
+	if (dirtyDataBufCnt == 0)
+		return;
+
+	for (listNo = 0; listNo < DATA_BUF_LIST_COUNT; listNo++)
+	{
+		scanCnt = 0;
+		dataBufEntry = dataBufLruList[listNo].tailEntry;
+		while ((dataBufEntry != DATA_BUF_NONE) && (scanCnt < DATA_BUF_CLEAN_WATERMARK))
+		{
+			if (dataBufMapPtr->dataBuf[dataBufEntry].dirty == DATA_BUF_DIRTY)
+			{
+				WriteBackDataBufEntry(dataBufEntry, REQ_OPT_IO_CLASS_LOW);
+
+				if (notCompletedNandReqCnt + blockedReqCnt >= DATA_BUF_DESTAGE_NAND_REQ_LIMIT)
+					return;
+			}
 
-		dataBufMapPtr->dataBuf[dataBufEntry].dirty = DATA_BUF_CLEAN;
+			dataBufEntry = dataBufMapPtr->dataBuf[dataBufEntry].prevEntry;
+			scanCnt++;
+		}
 	}
 }
 
+void ReadDataBufEntryFromNand(unsigned int dataBufEntry, unsigned int virtualSliceAddr, unsigned int ioClass)
+{
+	unsigned int reqSlotTag;
+
+	dataBufMapPtr->dataBuf[dataBufEntry].validMask = DATA_BUF_VALID_ALL;
+
+	reqSlotTag = GetFromFreeReqQ();
+
+	reqPoolPtr->reqPool[reqSlotTag].reqType = REQ_TYPE_NAND;
+	reqPoolPtr->reqPool[reqSlotTag].reqCode = REQ_CODE_READ;
+	reqPoolPtr->reqPool[reqSlotTag].logicalSliceAddr = dataBufMapPtr->dataBuf[dataBufEntry].logicalSliceAddr;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat = REQ_OPT_DATA_BUF_ENTRY;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandAddr = REQ_OPT_NAND_ADDR_VSA;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandEcc = REQ_OPT_NAND_ECC_ON;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandEccWarning = REQ_OPT_NAND_ECC_WARNING_ON;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.rowAddrDependencyCheck = REQ_OPT_ROW_ADDR_DEPENDENCY_CHECK;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.blockSpace = REQ_OPT_BLOCK_SPACE_MAIN;
+	reqPoolPtr->reqPool[reqSlotTag].reqOpt.ioClass = ioClass;
+
+	reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry = dataBufEntry;
+	UpdateDataBufEntryInfoBlockingReq(dataBufEntry, reqSlotTag);
+	reqPoolPtr->reqPool[reqSlotTag].nandInfo.virtualSliceAddr = virtualSliceAddr;
+
+	SelectLowLevelReqQ(reqSlotTag);
+}
+
 void DataReadFromNand(unsigned int originReqSlotTag)
 {
-	unsigned int reqSlotTag, virtualSliceAddr;
+	unsigned int virtualSliceAddr;
 
 	virtualSliceAddr = AddrTransRead(reqPoolPtr->reqPool[originReqSlotTag].logicalSliceAddr);
 
+	if (virtualSliceAddr != VSA_FAIL)
+		ReadDataBufEntryFromNand(reqPoolPtr->reqPool[originReqSlotTag].dataBufInfo.entry, virtualSliceAddr, reqPoolPtr->reqPool[originReqSlotTag].reqOpt.ioClass);
+}
+
+// prefetches the slices following each detected sequential read stream, called while dies are idle
+void ReadAheadDataBuf()
+{
+	unsigned int streamNo, logicalSliceAddr, virtualSliceAddr, dataBufEntry;
+	P_READ_STREAM_ENTRY stream;
+
+	for (streamNo = 0; streamNo < READ_STREAM_COUNT; streamNo++)
+	{
+		stream = &readStreamTable.stream[streamNo];
+		if (stream->seqCnt < READ_STREAM_DETECT_THRESHOLD)
+			continue;
+
+		if (stream->prefetchLsa < stream->nextLsa)
+			stream->prefetchLsa = stream->nextLsa;
+
+		while ((stream->prefetchLsa < stream->nextLsa + stream->depth) && (stream->prefetchLsa < SLICES_PER_SSD))
+		{
+			if (notCompletedNandReqCnt + blockedReqCnt >= DATA_BUF_DESTAGE_NAND_REQ_LIMIT)
+				return;
+
+			// a prefetch never pays for a write back, leave dirty victims to the destager
+			if (dataBufMapPtr->dataBuf[SelectVictimDataBuf()].dirty == DATA_BUF_DIRTY)
+				return;
+
+			logicalSliceAddr = stream->prefetchLsa++;
+			if (FindDataBuf(logicalSliceAddr) != DATA_BUF_FAIL)
+				continue;
+
+			virtualSliceAddr = AddrTransRead(logicalSliceAddr);
+			if (virtualSliceAddr == VSA_FAIL)
+				continue;
+
+			// prefetched slices always start on probation
+			dataBufEntry = AllocateDataBuf(LSA_NONE);
+			dataBufMapPtr->dataBuf[dataBufEntry].logicalSliceAddr = logicalSliceAddr;
+			dataBufMapPtr->dataBuf[dataBufEntry].prefetched = DATA_BUF_PREFETCHED;
+			dataBufMapPtr->dataBuf[dataBufEntry].streamNo = streamNo;
+			PutToDataBufHashList(dataBufEntry);
+
+			ReadDataBufEntryFromNand(dataBufEntry, virtualSliceAddr, REQ_OPT_IO_CLASS_LOW);
+			readStreamTable.prefetchCnt++;
+		}
+	}
+}
+
+// returns 0 when the bypass ring is used up and the slice has to go through the data buffer
+unsigned int BypassDataBuf(unsigned int sliceReqSlotTag)
+{
+	unsigned int reqSlotTag, bufEntry, virtualSliceAddr;
+
+	bufEntry = AllocateBypassDataBuf();
+	if (bufEntry == DATA_BUF_FAIL)
+		return 0;
+
+	virtualSliceAddr = AddrTransRead(reqPoolPtr->reqPool[sliceReqSlotTag].logicalSliceAddr);
 	if (virtualSliceAddr != VSA_FAIL)
 	{
 		reqSlotTag = GetFromFreeReqQ();
 
 		reqPoolPtr->reqPool[reqSlotTag].reqType = REQ_TYPE_NAND;
 		reqPoolPtr->reqPool[reqSlotTag].reqCode = REQ_CODE_READ;
-		reqPoolPtr->reqPool[reqSlotTag].nvmeCmdSlotTag = reqPoolPtr->reqPool[originReqSlotTag].nvmeCmdSlotTag;
-		reqPoolPtr->reqPool[reqSlotTag].logicalSliceAddr = reqPoolPtr->reqPool[originReqSlotTag].logicalSliceAddr;
-		reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat = REQ_OPT_DATA_BUF_ENTRY;
+		reqPoolPtr->reqPool[reqSlotTag].logicalSliceAddr = reqPoolPtr->reqPool[sliceReqSlotTag].logicalSliceAddr;
+		reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat = REQ_OPT_DATA_BUF_BYPASS_ENTRY;
 		reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandAddr = REQ_OPT_NAND_ADDR_VSA;
 		reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandEcc = REQ_OPT_NAND_ECC_ON;
 		reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandEccWarning = REQ_OPT_NAND_ECC_WARNING_ON;
 		reqPoolPtr->reqPool[reqSlotTag].reqOpt.rowAddrDependencyCheck = REQ_OPT_ROW_ADDR_DEPENDENCY_CHECK;
 		reqPoolPtr->reqPool[reqSlotTag].reqOpt.blockSpace = REQ_OPT_BLOCK_SPACE_MAIN;
-
-		reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry = reqPoolPtr->reqPool[originReqSlotTag].dataBufInfo.entry;
-		UpdateDataBufEntryInfoBlockingReq(reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry, reqSlotTag);
+		reqPoolPtr->reqPool[reqSlotTag].reqOpt.ioClass = reqPoolPtr->reqPool[sliceReqSlotTag].reqOpt.ioClass;
+		reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry = bufEntry;
+		UpdateBypassDataBufEntryInfoBlockingReq(bufEntry, reqSlotTag);
 		reqPoolPtr->reqPool[reqSlotTag].nandInfo.virtualSliceAddr = virtualSliceAddr;
 
 		SelectLowLevelReqQ(reqSlotTag);
 	}
+
+	reqPoolPtr->reqPool[sliceReqSlotTag].reqType = REQ_TYPE_NVME_DMA;
+	reqPoolPtr->reqPool[sliceReqSlotTag].reqCode = REQ_CODE_TxDMA;
+	reqPoolPtr->reqPool[sliceReqSlotTag].dataBufInfo.entry = bufEntry;
+	UpdateBypassDataBufEntryInfoBlockingReq(bufEntry, sliceReqSlotTag);
+
+	SelectLowLevelReqQ(sliceReqSlotTag);
+
+	return 1;
 }
 
 void ReqTransSliceToLowLevel()
 {
-	unsigned int reqSlotTag, dataBufEntry;
+	unsigned int reqSlotTag, dataBufEntry, sliceCnt;
 
-	// 当 slice 请求队列头部不为空时，持续处理请求
-	while (sliceReqQ.headReq != REQ_SLOT_TAG_NONE)
+	// 按照仲裁顺序每次最多处理一批 slice 请求，其余的留在各类别队列中，下次调用时仍按权重仲裁
+	for (sliceCnt = 0; sliceCnt < SLICE_REQ_TRANSFORM_BATCH; sliceCnt++)
 	{
+		// NAND 请求队列已经足够深时暂停转换，等待中的 slice 之后再按类别挑选
+		if (notCompletedNandReqCnt + blockedReqCnt >= SLICE_REQ_NAND_REQ_LIMIT)
+			return;
+
 		// 从 slice 请求队列中获取一个请求槽标识符
 		reqSlotTag = GetFromSliceReqQ();
 
@@ -238,15 +463,30 @@ void ReqTransSliceToLowLevel()
 		// 为请求分配数据缓冲区条目
 		dataBufEntry = CheckDataBufHit(reqSlotTag);
 
+		// 大的顺序读请求未命中时绕过数据缓冲区，直接经由 bypass 缓冲区从 NAND 传给主机
+		if (reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat == REQ_OPT_DATA_BUF_BYPASS_ENTRY)
+		{
+			if ((dataBufEntry == DATA_BUF_FAIL) && BypassDataBuf(reqSlotTag))
+				continue;
+		}
+		else if (reqPoolPtr->reqPool[reqSlotTag].reqCode == REQ_CODE_READ)
+			UpdateReadStream(reqPoolPtr->reqPool[reqSlotTag].logicalSliceAddr);
+
 		// 如果数据缓冲区命中（即请求的数据已经在缓冲区中），则直接使用现有的缓冲区
 		if (dataBufEntry != DATA_BUF_FAIL)
 		{
 			reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry = dataBufEntry;
+			CheckPrefetchedDataBufHit(dataBufEntry, reqPoolPtr->reqPool[reqSlotTag].reqCode);
+
+			// 读请求命中部分有效的条目时，先从 NAND 合并缺失的块
+			if (reqPoolPtr->reqPool[reqSlotTag].reqCode == REQ_CODE_READ)
+				if ((dataBufMapPtr->dataBuf[dataBufEntry].validMask & DATA_BUF_VALID_MASK(reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.nvmeBlockOffset, reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.numOfNvmeBlock)) != DATA_BUF_VALID_MASK(reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.nvmeBlockOffset, reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.numOfNvmeBlock))
+					MergeDataBufEntryFromNand(dataBufEntry, reqPoolPtr->reqPool[reqSlotTag].reqOpt.ioClass);
 		}
 		else
 		{
 			// 如果数据缓冲区未命中，分配一个新的数据缓冲区条目
-			dataBufEntry = AllocateDataBuf();
+			dataBufEntry = AllocateDataBuf(reqPoolPtr->reqPool[reqSlotTag].logicalSliceAddr);
 			reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry = dataBufEntry;
 
 			// 清除已分配的数据缓冲区条目，这个条目之前可能已经被其他请求使用
@@ -260,18 +500,27 @@ void ReqTransSliceToLowLevel()
 
 			// 如果请求是读取操作，则从 NAND 中读取数据
 			if (reqPoolPtr->reqPool[reqSlotTag].reqCode == REQ_CODE_READ)
+			{
+				dataBufMapPtr->dataBuf[dataBufEntry].validMask = DATA_BUF_VALID_ALL;
 				DataReadFromNand(reqSlotTag);
+			}
 			else if (reqPoolPtr->reqPool[reqSlotTag].reqCode == REQ_CODE_WRITE)
-				// 如果请求是写操作并且是读-修改写操作（即写操作跨越多个块），也需要先读取数据
+			{
+				// 部分写不再立即读-修改-写，缺失的块推迟到淘汰或读命中时再从 NAND 合并，之后的写可能会填满整个 slice
+				dataBufMapPtr->dataBuf[dataBufEntry].validMask = 0;
 				if (reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.numOfNvmeBlock != NVME_BLOCKS_PER_SLICE)
-					DataReadFromNand(reqSlotTag);
+					dataBufPartialWriteCnt++;
+			}
 		}
 
 		// 将这个 slice 请求转换为 NVMe 请求
 		if (reqPoolPtr->reqPool[reqSlotTag].reqCode == REQ_CODE_WRITE)
 		{
 			// 如果是写操作，标记数据缓冲区为脏（已修改）
+			if (dataBufMapPtr->dataBuf[dataBufEntry].dirty == DATA_BUF_CLEAN)
+				dirtyDataBufCnt++;
 			dataBufMapPtr->dataBuf[dataBufEntry].dirty = DATA_BUF_DIRTY;
+			dataBufMapPtr->dataBuf[dataBufEntry].validMask |= DATA_BUF_VALID_MASK(reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.nvmeBlockOffset, reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.numOfNvmeBlock);
 			reqPoolPtr->reqPool[reqSlotTag].reqCode = REQ_CODE_RxDMA;
 		}
 		else if (reqPoolPtr->reqPool[reqSlotTag].reqCode == REQ_CODE_READ)
@@ -320,8 +569,12 @@ unsigned int CheckRowAddrDep(unsigned int reqSlotTag, unsigned int checkRowAddrD
 	{
 		if (checkRowAddrDepOpt == ROW_ADDR_DEPENDENCY_CHECK_OPT_SELECT)
 		{
+			// the block was reused while its erase is pending, wait behind the erase instead of spinning on it
 			if (rowAddrDependencyTablePtr->block[chNo][wayNo][blockNo].blockedEraseReqFlag)
-				SyncReleaseEraseReq(chNo, wayNo, blockNo);
+			{
+				reqPoolPtr->reqPool[reqSlotTag].reqOpt.rowAddrDepPostErase = REQ_OPT_ROW_ADDR_DEP_POST_ERASE;
+				return ROW_ADDR_DEPENDENCY_REPORT_BLOCKED;
+			}
 
 			if (pageNo < rowAddrDependencyTablePtr->block[chNo][wayNo][blockNo].permittedProgPage)
 				return ROW_ADDR_DEPENDENCY_REPORT_PASS;
@@ -330,6 +583,20 @@ unsigned int CheckRowAddrDep(unsigned int reqSlotTag, unsigned int checkRowAddrD
 		}
 		else if (checkRowAddrDepOpt == ROW_ADDR_DEPENDENCY_CHECK_OPT_RELEASE)
 		{
+			// not counted in blockedReadReqCnt until the erase it waits for has been released
+			if (reqPoolPtr->reqPool[reqSlotTag].reqOpt.rowAddrDepPostErase == REQ_OPT_ROW_ADDR_DEP_POST_ERASE)
+			{
+				if (rowAddrDependencyTablePtr->block[chNo][wayNo][blockNo].blockedEraseReqFlag)
+					return ROW_ADDR_DEPENDENCY_REPORT_BLOCKED;
+
+				reqPoolPtr->reqPool[reqSlotTag].reqOpt.rowAddrDepPostErase = REQ_OPT_ROW_ADDR_DEP_PRE_ERASE;
+				if (pageNo < rowAddrDependencyTablePtr->block[chNo][wayNo][blockNo].permittedProgPage)
+					return ROW_ADDR_DEPENDENCY_REPORT_PASS;
+
+				rowAddrDependencyTablePtr->block[chNo][wayNo][blockNo].blockedReadReqCnt++;
+				return ROW_ADDR_DEPENDENCY_REPORT_BLOCKED;
+			}
+
 			if (pageNo < rowAddrDependencyTablePtr->block[chNo][wayNo][blockNo].permittedProgPage)
 			{
 				rowAddrDependencyTablePtr->block[chNo][wayNo][blockNo].blockedReadReqCnt--;
@@ -376,7 +643,7 @@ unsigned int CheckRowAddrDep(unsigned int reqSlotTag, unsigned int checkRowAddrD
 
 unsigned int UpdateRowAddrDepTableForBufBlockedReq(unsigned int reqSlotTag)
 {
-	unsigned int dieNo, chNo, wayNo, blockNo, pageNo, bufDepCheckReport;
+	unsigned int dieNo, chNo, wayNo, blockNo;
 
 	if (reqPoolPtr->reqPool[reqSlotTag].reqOpt.nandAddr == REQ_OPT_NAND_ADDR_VSA)
 	{
@@ -384,32 +651,17 @@ unsigned int UpdateRowAddrDepTableForBufBlockedReq(unsigned int reqSlotTag)
 		chNo = Vdie2PchTranslation(dieNo);
 		wayNo = Vdie2PwayTranslation(dieNo);
 		blockNo = Vsa2VblockTranslation(reqPoolPtr->reqPool[reqSlotTag].nandInfo.virtualSliceAddr);
-		pageNo = Vsa2VpageTranslation(reqPoolPtr->reqPool[reqSlotTag].nandInfo.virtualSliceAddr);
 	}
 	else
 		assert(!"[WARNING] Not supported reqOpt-nandAddress [WARNING]");
 
 	if (reqPoolPtr->reqPool[reqSlotTag].reqCode == REQ_CODE_READ)
 	{
+		// released through CheckRowAddrDep once the pending erase of the reused block is done
 		if (rowAddrDependencyTablePtr->block[chNo][wayNo][blockNo].blockedEraseReqFlag)
-		{
-			SyncReleaseEraseReq(chNo, wayNo, blockNo);
-
-			bufDepCheckReport = CheckBufDep(reqSlotTag);
-			if (bufDepCheckReport == BUF_DEPENDENCY_REPORT_PASS)
-			{
-				if (pageNo < rowAddrDependencyTablePtr->block[chNo][wayNo][blockNo].permittedProgPage)
-					PutToNandReqQ(reqSlotTag, chNo, wayNo);
-				else
-				{
-					rowAddrDependencyTablePtr->block[chNo][wayNo][blockNo].blockedReadReqCnt++;
-					PutToBlockedByRowAddrDepReqQ(reqSlotTag, chNo, wayNo);
-				}
-
-				return ROW_ADDR_DEPENDENCY_TABLE_UPDATE_REPORT_SYNC;
-			}
-		}
-		rowAddrDependencyTablePtr->block[chNo][wayNo][blockNo].blockedReadReqCnt++;
+			reqPoolPtr->reqPool[reqSlotTag].reqOpt.rowAddrDepPostErase = REQ_OPT_ROW_ADDR_DEP_POST_ERASE;
+		else
+			rowAddrDependencyTablePtr->block[chNo][wayNo][blockNo].blockedReadReqCnt++;
 	}
 	else if (reqPoolPtr->reqPool[reqSlotTag].reqCode == REQ_CODE_ERASE)
 		rowAddrDependencyTablePtr->block[chNo][wayNo][blockNo].blockedEraseReqFlag = 1;
@@ -528,11 +780,23 @@ void ReleaseBlockedByBufDepReq(unsigned int reqSlotTag)
 		if (dataBufMapPtr->dataBuf[reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry].blockingReqTail == reqSlotTag)
 			dataBufMapPtr->dataBuf[reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry].blockingReqTail = REQ_SLOT_TAG_NONE;
 	}
+	else if (reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat == REQ_OPT_DATA_BUF_MERGE_ENTRY)
+	{
+		if (dataBufMapPtr->dataBuf[reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry].blockingReqTail == reqSlotTag)
+			dataBufMapPtr->dataBuf[reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry].blockingReqTail = REQ_SLOT_TAG_NONE;
+
+		bypassDataBufMapPtr->bypassDataBuf[dataBufMapPtr->dataBuf[reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry].mergeEntry].blockingReqTail = REQ_SLOT_TAG_NONE;
+	}
 	else if (reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat == REQ_OPT_DATA_BUF_TEMP_ENTRY)
 	{
 		if (tempDataBufMapPtr->tempDataBuf[reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry].blockingReqTail == reqSlotTag)
 			tempDataBufMapPtr->tempDataBuf[reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry].blockingReqTail = REQ_SLOT_TAG_NONE;
 	}
+	else if (reqPoolPtr->reqPool[reqSlotTag].reqOpt.dataBufFormat == REQ_OPT_DATA_BUF_BYPASS_ENTRY)
+	{
+		if (bypassDataBufMapPtr->bypassDataBuf[reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry].blockingReqTail == reqSlotTag)
+			bypassDataBufMapPtr->bypassDataBuf[reqPoolPtr->reqPool[reqSlotTag].dataBufInfo.entry].blockingReqTail = REQ_SLOT_TAG_NONE;
+	}
 
 	if ((targetReqSlotTag != REQ_SLOT_TAG_NONE) && (reqPoolPtr->reqPool[targetReqSlotTag].reqQueueType == REQ_QUEUE_TYPE_BLOCKED_BY_BUF_DEP))
 	{
@@ -608,27 +872,17 @@ void ReleaseBlockedByRowAddrDepReq(unsigned int chNo, unsigned int wayNo)
 
 void IssueNvmeDmaReq(unsigned int reqSlotTag)
 {
-	unsigned int devAddr, dmaIndex, numOfNvmeBlock;
+	unsigned int devAddr, dmaIndex;
 
-	// 获取 DMA 索引，起始地址和 NVMe 块的数量
+	// 获取 DMA 索引和起始地址
 	dmaIndex = reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.startIndex;
 	devAddr = GenerateDataBufAddr(reqSlotTag); // 生成数据缓冲区的物理地址
-	numOfNvmeBlock = 0;						   // 初始化已处理的 NVMe 块数
 
+	// 一个 slice 内的 NVMe 块在数据缓冲区和命令中都是连续的，一次性压入 DMA FIFO，只检查一次 FIFO 空间
 	// 如果请求是接收 DMA 请求 (RxDMA)
 	if (reqPoolPtr->reqPool[reqSlotTag].reqCode == REQ_CODE_RxDMA)
 	{
-		// 循环处理所有需要接收的 NVMe 块
-		while (numOfNvmeBlock < reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.numOfNvmeBlock)
-		{
-			// 设置自动接收 DMA 操作
-			set_auto_rx_dma(reqPoolPtr->reqPool[reqSlotTag].nvmeCmdSlotTag, dmaIndex, devAddr, NVME_COMMAND_AUTO_COMPLETION_ON);
-
-			// 更新已处理的 NVMe 块数，调整 DMA 索引和数据地址
-			numOfNvmeBlock++;
-			dmaIndex++;
-			devAddr += BYTES_PER_NVME_BLOCK; // 偏移到下一个 NVMe 块
-		}
+		set_auto_rx_dma_blocks(reqPoolPtr->reqPool[reqSlotTag].nvmeCmdSlotTag, dmaIndex, devAddr, reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.numOfNvmeBlock, NVME_COMMAND_AUTO_COMPLETION_ON);
 
 		// 设置 DMA 请求的尾部指针和溢出计数
 		reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.reqTail = g_hostDmaStatus.fifoTail.autoDmaRx;
@@ -637,17 +891,7 @@ void IssueNvmeDmaReq(unsigned int reqSlotTag)
 	// 如果请求是发送 DMA 请求 (TxDMA)
 	else if (reqPoolPtr->reqPool[reqSlotTag].reqCode == REQ_CODE_TxDMA)
 	{
-		// 循环处理所有需要发送的 NVMe 块
-		while (numOfNvmeBlock < reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.numOfNvmeBlock)
-		{
-			// 设置自动发送 DMA 操作
-			set_auto_tx_dma(reqPoolPtr->reqPool[reqSlotTag].nvmeCmdSlotTag, dmaIndex, devAddr, NVME_COMMAND_AUTO_COMPLETION_ON);
-
-			// 更新已处理的 NVMe 块数，调整 DMA 索引和数据地址
-			numOfNvmeBlock++;
-			dmaIndex++;
-			devAddr += BYTES_PER_NVME_BLOCK; // 偏移到下一个 NVMe 块
-		}
+		set_auto_tx_dma_blocks(reqPoolPtr->reqPool[reqSlotTag].nvmeCmdSlotTag, dmaIndex, devAddr, reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.numOfNvmeBlock, NVME_COMMAND_AUTO_COMPLETION_ON);
 
 		// 设置 DMA 请求的尾部指针和溢出计数
 		reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.reqTail = g_hostDmaStatus.fifoTail.autoDmaTx;
@@ -660,34 +904,51 @@ void IssueNvmeDmaReq(unsigned int reqSlotTag)
 
 void CheckDoneNvmeDmaReq()
 {
-	unsigned int reqSlotTag, prevReq;
-	unsigned int rxDone, txDone;
+	unsigned int reqSlotTag;
+#ifdef NVME_DMA_DONE_PROFILE
+	static XTime doneTime = 0;
+	static unsigned int doneCnt = 0;
+	XTime tStart, tEnd;
+#endif
+
+	if ((nvmeDmaReqQ[NVME_DMA_REQ_Q_RX].headReq == REQ_SLOT_TAG_NONE) && (nvmeDmaReqQ[NVME_DMA_REQ_Q_TX].headReq == REQ_SLOT_TAG_NONE))
+		return;
 
-	reqSlotTag = nvmeDmaReqQ.tailReq;
-	rxDone = 0;
-	txDone = 0;
+#ifdef NVME_DMA_DONE_PROFILE
+	XTime_GetTime(&tStart);
+#endif
+	// one fifo head snapshot for the whole pass, every request is checked against it
+	update_auto_dma_fifo_head();
 
-	while (reqSlotTag != REQ_SLOT_TAG_NONE)
+	// 每个方向的 DMA 按发出顺序完成，只需从队头退役，遇到第一个未完成的请求即停止
+	reqSlotTag = nvmeDmaReqQ[NVME_DMA_REQ_Q_RX].headReq;
+	while ((reqSlotTag != REQ_SLOT_TAG_NONE) && check_auto_rx_dma_batch_done(reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.reqTail, reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.overFlowCnt))
 	{
-		prevReq = reqPoolPtr->reqPool[reqSlotTag].prevReq;
-
-		if (reqPoolPtr->reqPool[reqSlotTag].reqCode == REQ_CODE_RxDMA)
-		{
-			if (!rxDone)
-				rxDone = check_auto_rx_dma_partial_done(reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.reqTail, reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.overFlowCnt);
-
-			if (rxDone)
-				SelectiveGetFromNvmeDmaReqQ(reqSlotTag);
-		}
-		else
-		{
-			if (!txDone)
-				txDone = check_auto_tx_dma_partial_done(reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.reqTail, reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.overFlowCnt);
+		GetFromNvmeDmaReqQ(NVME_DMA_REQ_Q_RX);
+		reqSlotTag = nvmeDmaReqQ[NVME_DMA_REQ_Q_RX].headReq;
+#ifdef NVME_DMA_DONE_PROFILE
+		doneCnt++;
+#endif
+	}
 
-			if (txDone)
-				SelectiveGetFromNvmeDmaReqQ(reqSlotTag);
-		}
+	reqSlotTag = nvmeDmaReqQ[NVME_DMA_REQ_Q_TX].headReq;
+	while ((reqSlotTag != REQ_SLOT_TAG_NONE) && check_auto_tx_dma_batch_done(reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.reqTail, reqPoolPtr->reqPool[reqSlotTag].nvmeDmaInfo.overFlowCnt))
+	{
+		GetFromNvmeDmaReqQ(NVME_DMA_REQ_Q_TX);
+		reqSlotTag = nvmeDmaReqQ[NVME_DMA_REQ_Q_TX].headReq;
+#ifdef NVME_DMA_DONE_PROFILE
+		doneCnt++;
+#endif
+	}
+#ifdef NVME_DMA_DONE_PROFILE
+	XTime_GetTime(&tEnd);
+	doneTime += tEnd - tStart;
 
-		reqSlotTag = prevReq;
+	if (doneCnt >= NVME_DMA_DONE_PROFILE_COUNT)
+	{
+		xil_printf("CheckDoneNvmeDmaReq: %d ticks per %d completions\r\n", (unsigned int)doneTime, doneCnt);
+		doneTime = 0;
+		doneCnt = 0;
 	}
+#endif
 }
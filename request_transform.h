@@ -52,6 +52,8 @@
 #define NVME_COMMAND_AUTO_COMPLETION_OFF	0
 #define NVME_COMMAND_AUTO_COMPLETION_ON		1
 
+// #define NVME_DMA_DONE_PROFILE
+
 #define ROW_ADDR_DEPENDENCY_CHECK_OPT_SELECT	0
 #define ROW_ADDR_DEPENDENCY_CHECK_OPT_RELEASE	1
 
@@ -64,6 +66,11 @@
 #define ROW_ADDR_DEPENDENCY_TABLE_UPDATE_REPORT_DONE	0
 #define ROW_ADDR_DEPENDENCY_TABLE_UPDATE_REPORT_SYNC	1
 
+// slices converted per call, the others wait in their class queue so that the arbitration weights pick the next ones
+#define SLICE_REQ_TRANSFORM_BATCH		(USER_DIES)
+// conversion pauses while the dies hold this much work, the nand request queues are fifo and know no class
+#define SLICE_REQ_NAND_REQ_LIMIT		(2 * USER_DIES)
+
 
 typedef struct _ROW_ADDR_DEPENDENCY_ENTRY {
 	unsigned int permittedProgPage : 12;
@@ -77,8 +84,15 @@ typedef struct _ROW_ADDR_DEPENDENCY_TABLE {
 } ROW_ADDR_DEPENDENCY_TABLE, *P_ROW_ADDR_DEPENDENCY_TABLE;
 
 void InitDependencyTable();
-void ReqTransNvmeToSlice(unsigned int cmdSlotTag, unsigned int startLba, unsigned int nlb, unsigned int cmdCode);
+void ReqTransNvmeToSlice(unsigned int cmdSlotTag, unsigned int startLba, unsigned int nlb, unsigned int cmdCode, unsigned int ioClass);
+unsigned int BypassDataBuf(unsigned int sliceReqSlotTag);
 void ReqTransSliceToLowLevel();
+void MergeDataBufEntryFromNand(unsigned int dataBufEntry, unsigned int ioClass);
+void CopyMergedDataBufEntry(unsigned int reqSlotTag);
+void WriteBackDataBufEntry(unsigned int dataBufEntry, unsigned int ioClass);
+void DestageDataBuf();
+void ReadDataBufEntryFromNand(unsigned int dataBufEntry, unsigned int virtualSliceAddr, unsigned int ioClass);
+void ReadAheadDataBuf();
 void IssueNvmeDmaReq(unsigned int reqSlotTag);
 void CheckDoneNvmeDmaReq();
 